@@ -29,6 +29,15 @@
 #include "list.h"
 #include "scroll.h"
 #include "files.h"
+#include "search.h"
+#include "enc.h"
+#include "doc.h"
+#include "export.h"
+#include "history.h"
+#include "cache.h"
+#include "prefetch.h"
+#include "meta.h"
+#include "loader.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -45,12 +54,14 @@ typedef void (*update_title_del_func_t)(char*);
 typedef enum {
 	CS_TYPING,
 	CS_SAVING,
-	CS_OPENING
+	CS_OPENING,
+	CS_SEARCHING
 } cs_app_state_t;
 
 static Frame * frm = 0;
 static Line * filename = 0;
 static Line * filename_buf = 0;
+static Line * filter_buf = 0;
 
 static files_t * files = 0; 
 
@@ -58,11 +69,27 @@ static update_title_del_func_t update_title_del = 0;
 
 static anim_del_t * scroll_anim_del = 0;
 static anim_del_t * disp_anim_del = 0;
+static anim_del_t * index_anim_del = 0;
+static anim_del_t * export_anim_del = 0;
+static anim_del_t * meta_anim_del = 0;
+static anim_del_t * load_anim_del = 0;
 static fullscreen_del_func_t fullscreen_del = 0;
 static int is_fullscreen = 0;
 static quit_del_func_t quit_del = 0;
 
 static int save_err = 0;
+static int indexing = 0;
+static int exporting = 0;
+static int refreshing = 0;       // the open screen's metadata
+static int loading = 0;          // the start of the frame's document
+static int history_back = 0;
+static int drafted = 0;         // the frame's last save has a snapshot
+
+// the frame holds what its file did (with this mtime and size) as long
+// as its stamp is still clean_stamp
+static unsigned long clean_stamp = 0;
+static unsigned long long clean_mtime = 0;
+static unsigned long long clean_size = 0;
 
 static cs_app_state_t app_state = CS_TYPING;
 static scrolling_t open_scroll = {0};
@@ -74,6 +101,18 @@ static
 int
 App_Save();
 
+static
+void
+App_FilterFiles();
+
+static
+Frame *
+App_Load(char * the_filename);
+
+static
+void
+App_PollLoad(int wait);
+
 
 static
 void
@@ -138,6 +177,14 @@ App_OnDestroy()
 	scroll_anim_del = 0;
 	Anim_Destroy(disp_anim_del);
 	disp_anim_del = 0;
+	Anim_Destroy(index_anim_del);
+	index_anim_del = 0;
+	Anim_Destroy(export_anim_del);
+	export_anim_del = 0;
+	Anim_Destroy(meta_anim_del);
+	meta_anim_del = 0;
+	Anim_Destroy(load_anim_del);
+	load_anim_del = 0;
 	
 	Line_Destroy(filename);
 	filename = 0;
@@ -147,7 +194,18 @@ App_OnDestroy()
 	Line_Destroy(filename_buf);
 	filename_buf = 0;
 	
-	Files_Destroy(files);
+	Line_Destroy(filter_buf);
+	filter_buf = 0;
+	
+	Export_Cleanup();
+	Loader_Cleanup();
+	Prefetch_Cleanup();
+	Meta_Cleanup();
+	Search_Cleanup();
+	History_Cleanup();
+	Cache_Cleanup();
+	Files_Cleanup();
+	files = 0;
 	
 	Disp_Destroy();
 	
@@ -163,24 +221,192 @@ App_OnResize(int w, int h)
 }
 
 
+/**************************************************************************
+ * OnScale
+ *
+ * The display scale factor (1.0 is 96 dpi), reported by the platform
+ * at startup and whenever the user changes it.
+ **************************************************************************/
+
+void
+App_OnScale(float scale)
+{
+	Disp_SetScale(scale);
+}
+
+
+// keeps the search index build going until it's done; the frames
+// keep coming while it runs (the index anim) so its progress shows
+static
+void
+App_PollIndex(int * done, int * total)
+{
+	if(indexing && !Search_Progress(done, total)) {
+		indexing = 0;
+		Anim_End(index_anim_del);
+
+		// the old results went with the old index
+		if(app_state == CS_SEARCHING) {
+			App_FilterFiles();
+		}
+	}
+}
+
+
+// same for an export, which shows on every screen
+static
+void
+App_PollExport(int * done, int * total)
+{
+	if(exporting && !Export_Progress(done, total)) {
+		exporting = 0;
+		Anim_End(export_anim_del);
+	}
+}
+
+
+// and for the open screen's metadata, which fills in as it comes
+static
+void
+App_PollMeta()
+{
+	int done = 0;
+	int total = 0;
+
+	if(refreshing && !Meta_Progress(&done, &total)) {
+		refreshing = 0;
+		Anim_End(meta_anim_del);
+	}
+}
+
+// starts it over each time the list is opened, so what changed is seen
+static
+void
+App_RefreshMeta()
+{
+	if(!refreshing && Meta_StartSync()) {
+		refreshing = 1;
+		Anim_Start(meta_anim_del);
+	}
+}
+
+
+// the document under the open screen's cursor, if any
+static
+char *
+App_Highlighted()
+{
+	double amt = open_scroll.amt;
+	int file_num = (int)(open_scroll.dir == SCROLL_UP ? ceil(amt) : floor(amt));
+
+	if(files && file_num >= 0 && file_num < files->len) {
+		return files->names[file_num];
+	}
+
+	return NULL;
+}
+
+
+// off the open screen, nothing's read ahead, and a document that was
+// but didn't get opened is kept with the others left a moment ago
+static
+void
+App_KeepPrefetched()
+{
+	char * name;
+	Frame * left;
+	unsigned long long mtime;
+	unsigned long long size;
+
+	Prefetch_Hint(NULL, NULL);
+
+	// (one still being read turns up here on a later render)
+	left = Prefetch_Release(&name, &mtime, &size);
+	if(left) {
+		// unless it's the one that's open anyway
+		if(!filename || strcmp(name, Line_Text(filename))) {
+			Cache_Put(name, left, mtime, size);
+		} else {
+			Frame_Destroy(left);
+		}
+		free(name);
+	}
+}
+
+// the first line of what the cursor rests on, under the list
+static
+void
+App_ShowPreview()
+{
+	char * name = App_Highlighted();
+	meta_t meta;
+
+	if(name && Meta_Get(name, &meta) && *meta.preview) {
+		Disp_Note((char *)meta.preview);
+	}
+}
+
+
 void
 App_OnRender()
 {
+	int done = 0;
+	int total = 0;
+	int exported = 0;
+	int to_export = 0;
+
+	App_PollIndex(&done, &total);
+	App_PollExport(&exported, &to_export);
+	App_PollMeta();
+	App_PollLoad(0);
+
+	// what the cursor rests on is read ahead, in case it's opened
+	if(app_state == CS_OPENING || app_state == CS_SEARCHING) {
+		Prefetch_Hint(App_Highlighted(), App_Load);
+	} else {
+		App_KeepPrefetched();
+	}
+
 	Disp_BeginRender();
 	
 	switch(app_state) {
 	case CS_TYPING:
 		Disp_TypingScreen(frm, &text_scroll);
+
+		// until it's saved, and so converted for good
+		if(Frame_Imported(frm) && !exporting) {
+			char buf[96];
+
+			sprintf(buf, "Imported from %.40s; saves as UTF-8", Frame_Imported(frm));
+			Disp_Status(buf);
+		}
 		break;
 	case CS_SAVING:
 		Disp_SaveScreen(Line_Text(filename_buf), save_err);
 		break;
 	case CS_OPENING:
-		Disp_OpenScreen(files, &open_scroll);
+		Disp_OpenScreen(files, Line_Text(filter_buf), &open_scroll);
+		App_ShowPreview();
+		break;
+	case CS_SEARCHING:
+		Disp_OpenScreen(files, Line_Text(filter_buf), &open_scroll);
+
+		if(indexing) {
+			Disp_Progress("Indexing", done, total);
+		} else {
+			App_ShowPreview();
+		}
 		break;
 	default:
 		break;
 	}
+
+	if(exporting) {
+		char buf[64];
+
+		sprintf(buf, "Exporting %d / %d", exported, to_export);
+		Disp_Status(buf);
+	}
 }
 
 
@@ -239,9 +465,11 @@ App_OnSpecialKeyDown(cs_key_t key, cs_key_mod_t mods)
 			cur_scroll = &text_scroll;
 			Line_Destroy(filename_buf);
 			filename_buf = 0;
-		} else if(app_state == CS_OPENING) {
+		} else if(app_state == CS_OPENING || app_state == CS_SEARCHING) {
 			app_state = CS_TYPING;
 			cur_scroll = &text_scroll;
+			Line_Destroy(filter_buf);
+			filter_buf = 0;
 		} else if(app_state == CS_TYPING) {
 			if(is_fullscreen && fullscreen_del) {
 				fullscreen_del();
@@ -269,9 +497,8 @@ App_OnChar(char * ch, Frame * frm)
 	case '\b':
 		Frame_DeleteCh(frm);
 		break;
-	//ignore the carriage return
+	//ignore the carriage return (files have theirs taken out by App_Read)
 	case '\r':
-		fprintf(stderr, "whoa! carriage returns are old school.\ntry the linefeed from now on. strlen: %d\n", (int)strlen(ch));
 		break;
 
 	/* Handle just newlines.
@@ -295,53 +522,158 @@ App_OnChar(char * ch, Frame * frm)
  * File management
  **************************************************************************/
 
+/**************************************************************************
+ * NormalizeEol
+ *
+ * Turns every line end in buf (LF, CRLF, lone CR, LS or PS) into a
+ * plain '\n' in place, in one pass before anything reaches the frame,
+ * and returns the most common one so saving writes the file back the
+ * way it came. *len is updated to the shorter length, and *mixed says
+ * whether any line end wasn't the common one.
+ **************************************************************************/
+
 static
-int
-App_Read(FILE * file)
+frame_eol_t
+App_NormalizeEol(char * buf, long * len, int * mixed)
 {
-	char * buffer;
-	char ch[7];
+	long counts[EOL_PS + 1] = {0};
+	unsigned char * s = (unsigned char *)buf;
+	long n = *len;
+	long r = 0;
+	long w = 0;
+	int eol = EOL_LF;
+	int i;
+
+	while(r < n) {
+		unsigned char c = s[r];
+
+		if(c == '\r') {
+			if(r + 1 < n && s[r + 1] == '\n') {
+				++counts[EOL_CRLF];
+				r += 2;
+			} else {
+				++counts[EOL_CR];
+				++r;
+			}
+			s[w++] = '\n';
+		} else if(c == 0xE2 && r + 2 < n && s[r + 1] == 0x80 &&
+			(s[r + 2] == 0xA8 || s[r + 2] == 0xA9)) {
+			++counts[s[r + 2] == 0xA8 ? EOL_LS : EOL_PS];
+			r += 3;
+			s[w++] = '\n';
+		} else {
+			counts[EOL_LF] += (c == '\n');
+			s[w++] = c;
+			++r;
+		}
+	}
+
+	for(i = EOL_LF; i <= EOL_PS; ++i) {
+		if(counts[i] > counts[eol]) {
+			eol = i;
+		}
+	}
+
+	*len = w;
+	*mixed = 0;
+	for(i = EOL_LF; i <= EOL_PS; ++i) {
+		*mixed |= (i != eol && counts[i] > 0);
+	}
+
+	return (frame_eol_t)eol;
+}
+
+typedef struct {
+	const char * text;
 	long len;
-	size_t result;
-	long i;
-	Rune rune;
-	int size;
-	int valid = 1;
-	
-	Frame * new_frm = Frame_Init(CHARS_PER_LINE);
-	
-	//get the file size
-	fseek(file, 0, SEEK_END);
-	len = ftell(file);
-	rewind(file);
+	long at;
+	int same;
+} app_match_t;
+
+// a frame_write_t that checks the text against what was read
+static
+int
+App_Match(void * ctx, const char * buf, int len)
+{
+	app_match_t * m = (app_match_t *)ctx;
+
+	m->same = m->same && m->at + len <= m->len && !memcmp(&m->text[m->at], buf, len);
+	m->at += len;
+
+	return m->same;
+}
+
+// the frame being left is kept to come back to if it's what's in its
+// file; if it has unsaved changes, they're dropped as ever
+static
+void
+App_SetFrame(Frame * new_frm)
+{
+	if(filename && Frame_Stamp(frm) == clean_stamp) {
+		Cache_Put(Line_Text(filename), frm, clean_mtime, clean_size);
+	} else {
+		Frame_Destroy(frm);
+	}
+
+	frm = new_frm;
+	drafted = 0;
+}
+
+// how a document's text is to be filled in, once it's been decoded
+typedef struct {
+	frame_eol_t eol;
+	int same;       // the text is what the file holds, byte for byte
+	const char * imported;  // what it was converted from, or 0
+} app_fill_t;
+
+// the start of a long document, which the loader fills in
+static app_fill_t head_fill;
+
+// turns the malloc'd contents of a document into UTF-8 text with '\n'
+// line ends (updating buffer and len); 0 if out of memory, when the
+// buffer is gone
+static
+int
+App_Decode(char ** buffer, long * len, int from_disk, app_fill_t * fill)
+{
+	enc_t enc;
+	int mixed;
 	
-	buffer = (char *)malloc(sizeof(char) * len);
-	if (!buffer) {
-		fputs("Memory error for App_Read", stderr); 
+	// anything that isn't UTF-8 (UTF-16, Windows-1252) is converted
+	// first; the search indexer reads documents the same way
+	*buffer = Enc_ToUtf8(*buffer, len, &enc);
+	if(!*buffer) {
+		fputs("Memory error for App_Read", stderr);
 		return 0;
 	}
 	
-	//printf("Got mem, now reading...\n");
+	// the typing screen says so, as saving writes it back as UTF-8
+	fill->imported = (enc != ENC_UTF8) ? Enc_Name(enc) : 0;
+	fill->eol = App_NormalizeEol(*buffer, len, &mixed);
+	fill->same = (from_disk && enc == ENC_UTF8 && !mixed);
 	
-	result = fread(buffer, 1, len, file);
-
-	//printf("len: %ld result: %ld", len, result);
+	return 1;
+}
 
-	if(result != len) {
-		fputs("Reading error for App_Read", stderr);
-		return 0;
-	}
+// makes a frame of decoded text; a loader_fill_t. It touches nothing
+// else, so documents can be read on another thread.
+static
+Frame *
+App_Fill(char * text, long len, void * arg)
+{
+	app_fill_t * fill = (app_fill_t *)arg;
+	char ch[7];
+	long i;
+	Rune rune;
+	int size;
+	app_match_t match;
+	
+	Frame * new_frm = Frame_Init(CHARS_PER_LINE);
 	
 	//printf("Read into mem, now filling the frame with len: %ld\n", len);
 	
 	for(i = 0; i < len; i += size) {
-		chartorune(&rune, &buffer[i]);
-		
-		if(rune == Runeerror) {
-			fputs("Bad things happened! Error parsing file as UTF-8.", stderr);
-			valid = 0;
-			break;
-		}
+		chartorune(&rune, &text[i]);
 		
 		size = runetochar(ch, &rune);
 		ch[size] = '\0';
@@ -352,16 +684,140 @@ App_Read(FILE * file)
 		App_OnChar(ch, new_frm);
 	}
 	
+	// if the frame writes the file back byte for byte, saving only needs
+	// to write what's typed after this
+	match.text = text;
+	match.len = len;
+	match.at = 0;
+	match.same = fill->same;
+	if(match.same) {
+		Frame_Write(new_frm, App_Match, &match);
+	}
+	
+	Frame_SetEol(new_frm, fill->eol);
+	Frame_SetImported(new_frm, fill->imported);
+	if(match.same && match.at == len) {
+		Frame_MarkSaved(new_frm);
+	}
+	
+	return new_frm;
+}
+
+// makes a frame of the malloc'd contents of a document (which it frees);
+// from_disk if it's what the document's file holds now. It touches
+// nothing else, so documents can be read ahead on another thread.
+static
+Frame *
+App_Read(char * buffer, long len, int from_disk)
+{
+	app_fill_t fill;
+	Frame * new_frm;
+	
+	if(!App_Decode(&buffer, &len, from_disk, &fill)) {
+		return NULL;
+	}
+	
+	new_frm = App_Fill(buffer, len, &fill);
+	
 	free(buffer);
 
-	if(valid) {
-		Frame_Destroy(frm);
-		frm = new_frm;
+	return new_frm;
+}
+
+// a prefetch_load_t
+static
+Frame *
+App_Load(char * the_filename)
+{
+	long len = 0;
+
+	// unpacked on the way in if it's a .gz or .bz2
+	char * buffer = Doc_Read(the_filename, &len);
+
+	return buffer ? App_Read(buffer, len, 1) : NULL;
+}
+
+// where the last LOAD_TAIL_LINES lines on screen start (guessing at the
+// soft wraps), at the start of a hard line; 0 if that's all there is
+static
+long
+App_TailStart(char * text, long len)
+{
+	long start = len;
+	long i;
+	int lines = 0;
+	
+	for(i = len - 1; i >= 0 && lines < LOAD_TAIL_LINES; --i) {
+		if(text[i] == '\n') {
+			lines += 1 + (int)((start - i - 1) / CHARS_PER_LINE);
+			start = i + 1;
+		}
+	}
+	
+	return (lines < LOAD_TAIL_LINES) ? 0 : start;
+}
+
+// like App_Load, but a long document only has its end filled in now,
+// which is all the typing screen shows; the loader fills in the rest
+// and App_PollLoad puts it in front as it comes
+static
+Frame *
+App_LoadTail(char * the_filename)
+{
+	long len = 0;
+	long start;
+	Frame * new_frm;
+	char * buffer = Doc_Read(the_filename, &len);
+	
+	if(!buffer || !App_Decode(&buffer, &len, 1, &head_fill)) {
+		return NULL;
+	}
+	
+	start = (len > LOADER_PIECE) ? App_TailStart(buffer, len) : 0;
+	new_frm = App_Fill(&buffer[start], len - start, &head_fill);
+	
+	if(start > 0 && Loader_Start(buffer, start, App_Fill, &head_fill)) {
+		loading = 1;
+		Anim_Start(load_anim_del);
 	} else {
-		Frame_Destroy(new_frm);
+		// read it all now after all
+		if(start > 0) {
+			Frame_Prepend(new_frm, App_Fill(buffer, start, &head_fill));
+		}
+		free(buffer);
 	}
+	
+	return new_frm;
+}
 
-	return valid;
+// puts what the loader has filled in in front of the frame; with wait,
+// all of it, for anything that needs the whole text
+static
+void
+App_PollLoad(int wait)
+{
+	Frame * piece;
+	int more = 0;
+	
+	if(!loading) {
+		return;
+	}
+	
+	while((piece = Loader_Next(wait, &more))) {
+		// more text isn't a change to it
+		int clean = (Frame_Stamp(frm) == clean_stamp);
+		
+		Frame_Prepend(frm, piece);
+		
+		if(clean) {
+			clean_stamp = Frame_Stamp(frm);
+		}
+	}
+	
+	if(!more) {
+		loading = 0;
+		Anim_End(load_anim_del);
+	}
 }
 
 
@@ -388,27 +844,45 @@ static
 int
 App_Open(char * the_filename)
 {
-	int opened = 0;
-	FILE * file;
 	char * full_filename;
+	Frame * new_frm;
+	unsigned long long mtime = 0;
+	unsigned long long size = 0;
 	
 	full_filename = Files_GetAbsPath(the_filename);
 	
 	printf("Opening file: %s\n", full_filename);
-	file = fopen(full_filename, "rb");
-	
-	if(!file) {
-		fprintf(stderr, "Could not open requested file!\n");
-	} else {
-		opened = App_Read(file);
+	free(full_filename);
+
+	// the frame being left is whole before it's kept
+	App_PollLoad(1);
 
-		fclose(file);
-		printf("...Done.\n");
+	Files_Stat(the_filename, &mtime, &size);
+
+	// a document that was open a moment ago, or that the open screen
+	// was resting on, doesn't need reading now
+	new_frm = Cache_Take(the_filename);
+	if(!new_frm) {
+		new_frm = Prefetch_Take(the_filename, mtime, size);
+	}
+	if(!new_frm) {
+		new_frm = App_LoadTail(the_filename);
 	}
 	
-	free(full_filename);
+	if(!new_frm) {
+		fprintf(stderr, "Could not open requested file!\n");
+		return 0;
+	}
+
+	App_SetFrame(new_frm);
+	clean_stamp = Frame_Stamp(frm);
+	clean_mtime = mtime;
+	clean_size = size;
+	history_back = 0;
 
-	return opened;
+	printf("...Done.\n");
+
+	return 1;
 }
 
 
@@ -416,20 +890,62 @@ static
 int
 App_Save()
 {
-	FILE * file;
+	doc_writer_t * doc;
+	long from;
+	unsigned long long mtime = 0;
+	unsigned long long size = 0;
 	
 	char * the_filename = Line_Text(filename);
 	char * full_filename = Files_GetAbsPath(the_filename);
 	
+	// the whole text is written (or compared), so it has to be there
+	App_PollLoad(1);
+	from = Frame_SavedUpTo(frm);
+	
 	Files_CheckDocDir();
+	Files_BeginWrite();
 	
 	printf("Saving to file: %s\n", full_filename);
-	file = fopen(full_filename, "wb");
+	free(full_filename);
 
-	if(file) {
-		Frame_Write(frm, file);
-		fclose(file);
-		free(full_filename);
+	// typing only ever changes the end of the text, so a plain document
+	// that's still on disk gets just the part after the last save
+	// (packed on the way out, whole, if the name ends in .gz or .bz2);
+	// if anything else wrote to the file since, it's all written again
+	if(from > 0 && !(Files_Stat(the_filename, &mtime, &size) &&
+		mtime == clean_mtime && size == clean_size)) {
+		from = 0;
+	}
+
+	doc = (from > 0) ? Doc_Reopen(the_filename, from) : 0;
+	if(!doc) {
+		from = 0;
+		doc = Doc_Create(the_filename);
+	}
+
+	if(doc) {
+		Frame_WriteFrom(frm, from, Doc_Write, doc);
+
+		if(!Doc_Close(doc)) {
+			fputs("Could not write the whole file!\n", stderr);
+			return 0;
+		}
+
+		Frame_MarkSaved(frm);
+
+		clean_stamp = Files_Stat(the_filename, &clean_mtime, &clean_size) ? Frame_Stamp(frm) : 0;
+
+		// a failed snapshot doesn't fail the save; the one before
+		// is only good to start from if it's of this frame
+		drafted = History_Snapshot(the_filename, frm, drafted ? from : 0);
+		history_back = 0;
+
+		Files_Insert(the_filename);
+		// the index catches up in the background, like a sync
+		if(Search_Update(the_filename) && !indexing) {
+			indexing = 1;
+			Anim_Start(index_anim_del);
+		}
 		
 		puts("...Done.");
 		App_UpdateTitle(0);
@@ -440,21 +956,76 @@ App_Save()
 	return 0;
 }
 
+
+/**************************************************************************
+ * Restore
+ *
+ * Puts the previous draft of the document in the frame, one further
+ * back each time. Drafts that are what's there already are skipped (the
+ * newest one is the last save). It isn't saved until the user does.
+ **************************************************************************/
+
+static
+void
+App_Restore()
+{
+	app_match_t match;
+	char * buffer;
+	long len;
+	time_t when;
+	Frame * restored;
+
+	App_PollLoad(1);
+
+	while((buffer = History_Restore(Line_Text(filename), history_back, &len, &when))) {
+		history_back += 1;
+
+		match.text = buffer;
+		match.len = len;
+		match.at = 0;
+		match.same = 1;
+		Frame_Write(frm, App_Match, &match);
+
+		if(!match.same || match.at != len) {
+			break;
+		}
+		free(buffer);
+	}
+
+	if(!buffer) {
+		puts("No earlier drafts.");
+	} else if((restored = App_Read(buffer, len, 0))) {
+		App_SetFrame(restored);
+		clean_stamp = 0;
+
+		Scroll_Reset(&text_scroll);
+		App_UpdateTitle(1);
+
+		printf("Restored the draft from %s", ctime(&when));
+	}
+}
+
 static
 Line*
 App_CreateFileName()
 {
 	Line * file = 0;
-	int len;
-
-	len = strlen(Line_Text(filename_buf));
-
-	if(len > 0) {
-		file = Line_Init(len);
-		//copy the buffer
-		Line_InsertStr(file, Line_Text(filename_buf));
-		//tack on the .txt extension
-		Line_InsertStr(file, FILE_EXT);
+	char * typed = Line_Text(filename_buf);
+	int len = strlen(typed);
+	int pack_len = Doc_PackExtLen(typed);
+
+	if(len > pack_len) {
+		char * name = (char *)malloc(len + FILE_EXT_LEN + 1);
+
+		//copy the buffer and tack on the .txt extension (before a typed
+		//".gz" or ".bz2", so "notes.gz" is kept compressed as "notes.txt.gz")
+		memcpy(name, typed, len - pack_len);
+		strcpy(&name[len - pack_len], FILE_EXT);
+		strcat(name, &typed[len - pack_len]);
+
+		file = Line_Init(len + FILE_EXT_LEN + 1);
+		Line_InsertStr(file, name);
+		free(name);
 	}
 
 	return file;
@@ -548,6 +1119,22 @@ App_OnCharSave(char * ch)
 }
 
 
+// narrows the open list to the names containing what's been typed, or
+// when searching, lists the documents containing the typed words
+static
+void
+App_FilterFiles()
+{
+	if(app_state == CS_SEARCHING) {
+		files = Search_Query(Line_Text(filter_buf));
+	} else {
+		files = Files_Filter(Line_Text(filter_buf));
+	}
+
+	Scroll_Reset(&open_scroll);
+	open_scroll.limit = files->len - 1;
+}
+
 static
 void
 App_OnCharOpen(char * ch)
@@ -569,8 +1156,10 @@ App_OnCharOpen(char * ch)
 
 				App_SaveFilename(filename);
 
-				Files_Destroy(files);
+				// the list stays cached in the files module
 				files = 0;
+				Line_Destroy(filter_buf);
+				filter_buf = 0;
 			} else {
 				fputs("Error on open...\n", stderr);
 				Disp_TriggerOpenErrAnim();
@@ -583,7 +1172,18 @@ App_OnCharOpen(char * ch)
 		}
 		break;
 	}
+	case '\t':
+		break;
+	case 127:
+	case '\b':
+		Line_DeleteCh(filter_buf);
+		App_FilterFiles();
+		break;
 	default:
+		if(utflen(Line_Text(filter_buf)) < MAX_FILE_CHARS) {
+			Line_InsertCh(filter_buf, ch);
+			App_FilterFiles();
+		}
 		break;
 	}
 }
@@ -603,12 +1203,38 @@ App_OnKeyDown(char * ch, cs_key_mod_t mods)
 		case 'o':
 			if(app_state == CS_TYPING) {
 				app_state = CS_OPENING;
-				Scroll_Reset(&open_scroll);
+				cur_scroll = &open_scroll;
 
-				Files_Destroy(files);
-				files = Files_Populate();
-				open_scroll.limit = files->len - 1;
+				Line_Destroy(filter_buf);
+				filter_buf = Line_Init(CHARS_PER_LINE);
+				App_FilterFiles();
+				App_RefreshMeta();
+			}
+			break;
+		case 'k':
+			if(app_state == CS_TYPING) {
+				app_state = CS_SEARCHING;
 				cur_scroll = &open_scroll;
+
+				Line_Destroy(filter_buf);
+				filter_buf = Line_Init(CHARS_PER_LINE);
+				App_FilterFiles();
+
+				// only what changed since the last time is read again,
+				// in the background (of the list just shown); the old
+				// index answers till then
+				if(!indexing && Search_StartSync()) {
+					indexing = 1;
+					Anim_Start(index_anim_del);
+				}
+				App_RefreshMeta();
+			}
+			break;
+		case 'e':
+			// backs the documents up next to their folder, in the background
+			if(!exporting && Export_Start()) {
+				exporting = 1;
+				Anim_Start(export_anim_del);
 			}
 			break;
 		case 'q':
@@ -616,6 +1242,11 @@ App_OnKeyDown(char * ch, cs_key_mod_t mods)
 				quit_del();
 			}
 			break;
+		case 'r':
+			if(app_state == CS_TYPING && filename) {
+				App_Restore();
+			}
+			break;
 		case 's':
 			if(app_state == CS_TYPING) {
 				if(!filename) {
@@ -637,11 +1268,12 @@ App_OnKeyDown(char * ch, cs_key_mod_t mods)
 		if(app_state == CS_TYPING) {
 			Scroll_Reset(&text_scroll);
 			App_OnChar(ch, frm);
+			history_back = 0;
 
 			App_UpdateTitle(1);
 		} else if(app_state == CS_SAVING) {
 			App_OnCharSave(ch);
-		} else if(app_state == CS_OPENING) {
+		} else if(app_state == CS_OPENING || app_state == CS_SEARCHING) {
 			App_OnCharOpen(ch);
 		}
 	}
@@ -657,6 +1289,10 @@ App_AnimationDel(void (*OnStart)(void), void (*OnEnd)(void))
 {	
 	scroll_anim_del = Anim_Init(OnStart, OnEnd);
 	disp_anim_del = Anim_Init(OnStart, OnEnd);
+	index_anim_del = Anim_Init(OnStart, OnEnd);
+	export_anim_del = Anim_Init(OnStart, OnEnd);
+	meta_anim_del = Anim_Init(OnStart, OnEnd);
+	load_anim_del = Anim_Init(OnStart, OnEnd);
 	
 	Scroll_AnimationDel(&open_scroll, scroll_anim_del);
 	Scroll_AnimationDel(&text_scroll, scroll_anim_del);
@@ -42,6 +42,10 @@
 
 #define FONT_SIZE 24
 
+// a long document is shown once this many lines at its end are filled
+// in (more than fit on a screen); the rest come in the background
+#define LOAD_TAIL_LINES 256
+
 
 /**************************************************************************
  * Keys
@@ -91,6 +95,9 @@ App_OnDestroy();
 void
 App_OnResize(int w, int h);
 
+void
+App_OnScale(float scale);
+
 void
 App_OnRender();
 
@@ -0,0 +1,148 @@
+/*************************************************************************
+ * cache.c -- Keeps recently left documents ready to go back to.
+ *
+ * Candlestick App: Just Write. A minimalist, cross-platform writing app.
+ * Copyright (C) 2013 Thomas Klemz
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************************/
+
+#include "cache.h"
+#include "files.h"
+#include "list.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// what a line costs beyond its text: the list node, the Line itself,
+// the room it keeps spare and malloc's bookkeeping (roughly)
+#define CACHE_LINE_COST 160
+
+typedef struct {
+	char * name;
+	unsigned long long mtime;
+	unsigned long long size;
+	Frame * frm;
+	long bytes;
+} cache_entry_t;
+
+// least recently used first, after an empty head
+static Node * entries = 0;
+static long cache_bytes = 0;
+
+
+static
+void
+Cache_Remove(Node * node, int destroy)
+{
+	cache_entry_t * entry = (cache_entry_t *)node->data;
+
+	if(destroy) {
+		Frame_Destroy(entry->frm);
+	}
+
+	cache_bytes -= entry->bytes;
+	free(entry->name);
+	free(entry);
+	Node_Delete(node);
+}
+
+static
+Node *
+Cache_Find(char * name)
+{
+	Node * node = entries ? entries->next : 0;
+
+	while(node && strcmp(((cache_entry_t *)node->data)->name, name)) {
+		node = node->next;
+	}
+
+	return node;
+}
+
+void
+Cache_Put(char * name, Frame * frm, unsigned long long mtime, unsigned long long size)
+{
+	cache_entry_t * entry;
+	Node * node;
+	long bytes = Frame_Size(frm) + (long)Frame_NumLines(frm) * CACHE_LINE_COST;
+
+	if(!entries) {
+		entries = Node_Init();
+	}
+
+	// an older frame of the same document is out of date
+	if((node = Cache_Find(name))) {
+		Cache_Remove(node, 1);
+	}
+
+	if(bytes > CACHE_BUDGET) {
+		Frame_Destroy(frm);
+		return;
+	}
+
+	while(cache_bytes + bytes > CACHE_BUDGET) {
+		Cache_Remove(entries->next, 1);
+	}
+
+	entry = (cache_entry_t *)malloc(sizeof(cache_entry_t));
+	entry->name = (char *)malloc(strlen(name) + 1);
+	strcpy(entry->name, name);
+	entry->mtime = mtime;
+	entry->size = size;
+	entry->frm = frm;
+	entry->bytes = bytes;
+
+	node = Node_Init();
+	node->data = entry;
+	Node_Append(entries, node);
+	cache_bytes += bytes;
+}
+
+Frame*
+Cache_Take(char * name)
+{
+	Node * node = Cache_Find(name);
+	cache_entry_t * entry;
+	unsigned long long mtime;
+	unsigned long long size;
+	Frame * frm = 0;
+
+	if(!node) {
+		return 0;
+	}
+
+	entry = (cache_entry_t *)node->data;
+
+	// the file was written since (by something else), so it's read again
+	if(Files_Stat(name, &mtime, &size) && mtime == entry->mtime && size == entry->size) {
+		frm = entry->frm;
+	}
+
+	Cache_Remove(node, !frm);
+
+	return frm;
+}
+
+void
+Cache_Cleanup()
+{
+	while(entries && entries->next) {
+		Cache_Remove(entries->next, 1);
+	}
+
+	Node_Destroy(entries);
+	entries = 0;
+	cache_bytes = 0;
+}
@@ -0,0 +1,60 @@
+/*************************************************************************
+ * cache.h -- Keeps recently left documents ready to go back to.
+ *
+ * Candlestick App: Just Write. A minimalist, cross-platform writing app.
+ * Copyright (C) 2013 Thomas Klemz
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************************/
+
+#ifndef CS_CACHE_H
+#define CS_CACHE_H
+
+#include "frame.h"
+
+// how much memory the kept frames may take up together (build with
+// -DCACHE_BUDGET=... to change it)
+#ifndef CACHE_BUDGET
+#  define CACHE_BUDGET (64L * 1024 * 1024)
+#endif
+
+
+/**************************************************************************
+ * Put
+ *
+ * Hands over the frame of a document (name with extension) that holds
+ * just what its file did when it had the given mtime and size (see
+ * Files_Stat). The least recently used frames are destroyed to stay
+ * within CACHE_BUDGET; one that's bigger than that on its own isn't
+ * kept at all.
+ **************************************************************************/
+
+void
+Cache_Put(char * name, Frame * frm, unsigned long long mtime, unsigned long long size);
+
+
+/**************************************************************************
+ * Take
+ *
+ * Returns the document's frame, now the caller's, if one was put here
+ * and the file hasn't changed since; 0 if it has to be read again.
+ **************************************************************************/
+
+Frame*
+Cache_Take(char * name);
+
+void
+Cache_Cleanup();
+
+#endif
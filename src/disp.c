@@ -20,14 +20,23 @@
 
 #include "disp.h"
 #include "opengl.h"
+#include "glproc.h"
 #include "fnt.h"
 #include "utils.h"
+#include "utf.h"
+#include "meta.h"
 
 #include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define LINE_HEIGHT 1.95f
 #define OPEN_SCREEN_LINE_HEIGHT 40
 
+// layout constants are in 96 dpi pixels; scale them to the device
+#define PX(n) ((n) * disp_scale)
+
 
 /**************************************************************************
  * Display
@@ -35,6 +44,8 @@
 
 static int disp_h = 1;
 static int disp_w = 1;
+static float disp_scale = 1.0f;
+static float fnt_base_size = 0.0f;
 static Fnt * fnt_reg = 0;
 
 static int save_anim = 0;
@@ -65,7 +76,8 @@ Disp_DrawOpenIcon(int x, int y);
 void
 Disp_Init(int fnt_size)
 {	
-	fnt_reg = Fnt_Init(fnt_reg_name, fnt_size, LINE_HEIGHT);
+	fnt_base_size = fnt_size;
+	fnt_reg = Fnt_Init(fnt_reg_name, fnt_base_size * disp_scale, LINE_HEIGHT);
 
 	glShadeModel(GL_SMOOTH);
 	//NOTE: background color matched with TEXT_COLOR
@@ -76,19 +88,58 @@ Disp_Init(int fnt_size)
 	glHint(GL_PERSPECTIVE_CORRECTION_HINT, GL_NICEST);
 }
 
+static
+void
+Disp_DestroyTiles();
+
+static
+void
+Disp_DestroyPages();
+
 void
 Disp_Destroy()
 {
+	Disp_DestroyPages();
+	Disp_DestroyTiles();
 	Fnt_Destroy(fnt_reg);
 	//NOTE: should refactor the Fnt module so can use multiple fonts
 }
 
+/**************************************************************************
+ * SetScale
+ *
+ * The platform reports the display scale (1.0 == 96 dpi). The font is
+ * rasterized at device resolution, so the glyphs stay sharp, and since
+ * all layout derives from the font metrics the text simply reflows.
+ **************************************************************************/
+
+void
+Disp_SetScale(float scale)
+{
+	if(scale <= 0.0f || scale == disp_scale) {
+		return;
+	}
+
+	disp_scale = scale;
+
+	if(fnt_reg) {
+		Fnt_SetSize(fnt_reg, fnt_base_size * disp_scale);
+	}
+}
+
+float
+Disp_Scale()
+{
+	return disp_scale;
+}
+
 void
 Disp_BeginRender()
 {
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	glLoadIdentity();
-	glTranslatef(0.0f, 0.0f, -1.0f);
+	// every screen draws in window coords under this one setup
+	BeginScreenPass(disp_w, disp_h);
+	glLineWidth(disp_scale);
 	TEXT_COLOR
 }
 
@@ -238,6 +289,576 @@ Disp_AnimDel(anim_del_t * the_anim_del)
 }
 
 
+/**************************************************************************
+ * Line tiles
+ *
+ * Most of the visible lines never change while typing, so each one is
+ * rendered once into a slot of a shared tile texture (through a
+ * framebuffer object) and from then on drawn as a single textured quad.
+ * Slots remember the Line and its stamp, which changes on every edit,
+ * so an edited line is simply rendered again. A font size change throws
+ * the whole texture away. Without framebuffer support, or when every
+ * slot is in use this frame, lines are drawn glyph by glyph as before.
+ **************************************************************************/
+
+#define TILE_PAD 2
+#define TILE_TEX_MAX 2048
+
+typedef struct {
+	Line * line;
+	unsigned long stamp; //0 until the slot has been rendered
+	unsigned long used;  //frame the slot was last drawn in
+} tile_t;
+
+typedef struct {
+	Line * line;
+	int slot;
+} tile_ref_t;
+
+static tile_t * tiles = 0;
+static int num_tiles = 0;
+static int tiles_broken = 0;
+static int tiles_per_row = 0;
+static int tile_w = 0;
+static int tile_h = 0;
+static int tile_ascent = 0;
+static int tile_tex_w = 0;
+static int tile_tex_h = 0;
+static float tile_fnt_size = 0.0f;
+static unsigned long tile_frame = 0;
+static GLuint tile_tex = 0;
+static GLuint tile_fbo = 0;
+static tile_ref_t * tile_refs = 0;
+static int tile_refs_size = 0;
+
+static
+void
+Disp_DestroyTiles()
+{
+	if(tiles) {
+		glDeleteTextures(1, &tile_tex);
+		cs_glDeleteFramebuffers(1, &tile_fbo);
+		free(tiles);
+	}
+
+	free(tile_refs);
+
+	tiles = 0;
+	num_tiles = 0;
+	tile_refs = 0;
+	tile_refs_size = 0;
+	tile_fnt_size = 0.0f;
+	tiles_broken = 0;
+}
+
+static
+int
+Disp_InitTiles()
+{
+	GLint max_size = 0;
+	int complete;
+
+	if(tiles_broken || !GLProc_HasFramebuffers()) {
+		return 0;
+	}
+
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+
+	tile_ascent = (int)ceil(Fnt_Ascent(fnt_reg)) + TILE_PAD;
+	tile_h = tile_ascent + (int)ceil(Fnt_Descent(fnt_reg)) + TILE_PAD;
+	// a soft wrapped line may carry a trailing space past the limit
+	tile_w = (int)ceil((CHARS_PER_LINE + 2) * Fnt_Width(fnt_reg)) + 2 * TILE_PAD;
+
+	tile_tex_w = NextP2(tile_w);
+	tile_tex_h = (max_size < TILE_TEX_MAX) ? max_size : TILE_TEX_MAX;
+
+	if(tile_tex_w > max_size || tile_h > tile_tex_h) {
+		tiles_broken = 1;
+		return 0;
+	}
+
+	tiles_per_row = tile_tex_w / tile_w;
+	num_tiles = tiles_per_row * (tile_tex_h / tile_h);
+	tiles = (tile_t *)calloc(num_tiles, sizeof(tile_t));
+
+	glGenTextures(1, &tile_tex);
+	glBindTexture(GL_TEXTURE_2D, tile_tex);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, tile_tex_w, tile_tex_h, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+	cs_glGenFramebuffers(1, &tile_fbo);
+	cs_glBindFramebuffer(GL_FRAMEBUFFER, tile_fbo);
+	cs_glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tile_tex, 0);
+	complete = (cs_glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+	cs_glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if(!complete) {
+		Disp_DestroyTiles();
+		tiles_broken = 1;
+		return 0;
+	}
+
+	tile_fnt_size = Fnt_Size(fnt_reg);
+
+	return 1;
+}
+
+// returns the line's slot, claiming the least recently drawn one if it
+// has none; -1 if every slot is needed this frame
+static
+int
+Disp_FindTile(Line * line)
+{
+	int i;
+	int oldest = -1;
+
+	for(i = 0; i < num_tiles; ++i) {
+		if(tiles[i].line == line) {
+			return i;
+		}
+		if(tiles[i].used != tile_frame &&
+			(oldest < 0 || tiles[i].used < tiles[oldest].used)) {
+			oldest = i;
+		}
+	}
+
+	if(oldest >= 0) {
+		tiles[oldest].line = line;
+		tiles[oldest].stamp = 0;
+	}
+
+	return oldest;
+}
+
+static
+void
+Disp_RenderTile(int slot, Line * line);
+
+static
+int
+Disp_TilesReady()
+{
+	if(tiles && tile_fnt_size != Fnt_Size(fnt_reg)) {
+		Disp_DestroyTiles();
+	}
+
+	return tiles || Disp_InitTiles();
+}
+
+// finds (and if needed renders) the tile for a line drawn this frame
+static
+int
+Disp_TileFor(Line * line)
+{
+	int slot = Disp_FindTile(line);
+
+	if(slot >= 0) {
+		if(tiles[slot].stamp != Line_Stamp(line)) {
+			Disp_RenderTile(slot, line);
+		}
+		tiles[slot].used = tile_frame;
+	}
+
+	return slot;
+}
+
+static
+void
+Disp_RenderTile(int slot, Line * line)
+{
+	int sx = (slot % tiles_per_row) * tile_w;
+	int sy = (slot / tiles_per_row) * tile_h;
+
+	cs_glBindFramebuffer(GL_FRAMEBUFFER, tile_fbo);
+
+	glPushAttrib(GL_VIEWPORT_BIT | GL_SCISSOR_BIT | GL_COLOR_BUFFER_BIT | GL_ENABLE_BIT | GL_CURRENT_BIT);
+	glViewport(0, 0, tile_tex_w, tile_tex_h);
+
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	// same y-down orientation as the window; rows count from the top
+	gluOrtho2D(0, tile_tex_w, tile_tex_h, 0);
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(sx, tile_tex_h - sy - tile_h, tile_w, tile_h);
+	glClearColor(1.0f, 1.0f, 1.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	// Only coverage is kept (the color stays white and is tinted when
+	// the tile is drawn), so accumulate alpha with a plain "over".
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_TRUE);
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_TEXTURE_2D);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+
+	Fnt_DrawText(fnt_reg, Line_Text(line), sx + TILE_PAD, sy + tile_ascent);
+
+	glPopMatrix();
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+
+	glPopAttrib();
+
+	cs_glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	tiles[slot].stamp = Line_Stamp(line);
+}
+
+static
+void
+Disp_CompositeTile(int slot, int x, int y)
+{
+	float sx = (slot % tiles_per_row) * tile_w;
+	float sy = (slot / tiles_per_row) * tile_h;
+	float s0 = sx / tile_tex_w;
+	float s1 = (sx + tile_w) / tile_tex_w;
+	float t0 = 1.0f - sy / tile_tex_h;
+	float t1 = 1.0f - (sy + tile_h) / tile_tex_h;
+	int x0 = x - TILE_PAD;
+	int y0 = y - tile_ascent;
+
+	glTexCoord2f(s0, t0); glVertex2f(x0, y0);
+	glTexCoord2f(s1, t0); glVertex2f(x0 + tile_w, y0);
+	glTexCoord2f(s1, t1); glVertex2f(x0 + tile_w, y0 + tile_h);
+	glTexCoord2f(s0, t1); glVertex2f(x0, y0 + tile_h);
+}
+
+// Same contract as Fnt_PrintFrame: draws up to max_lines lines upwards
+// from the end of the frame, the first one at baseline y.
+static
+void
+Disp_PrintFrame(Frame * frm, int x, int y, int max_lines, int show_cursor)
+{
+	float h = Fnt_LineHeight(fnt_reg) * 1.55 * Fnt_Width(fnt_reg);
+	Line * cur_line;
+	int num = 0;
+	int i;
+
+	if(!Disp_TilesReady()) {
+		Fnt_PrintFrame(fnt_reg, frm, x, y, max_lines, show_cursor);
+		return;
+	}
+
+	if(tile_refs_size < max_lines) {
+		tile_refs_size = max_lines;
+		tile_refs = (tile_ref_t *)realloc(tile_refs, tile_refs_size * sizeof(tile_ref_t));
+	}
+
+	++tile_frame;
+
+	// first make sure every line has an up to date tile...
+	Frame_IterEnd(frm);
+
+	while(num < max_lines && (cur_line = Frame_IterPrev(frm))) {
+		int slot = -1;
+
+		// the line being typed on changes every keystroke
+		if(!(num == 0 && show_cursor)) {
+			slot = Disp_TileFor(cur_line);
+		}
+
+		tile_refs[num].line = cur_line;
+		tile_refs[num].slot = slot;
+		++num;
+	}
+
+	// ...then draw them all in one go
+	glEnable(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, tile_tex);
+
+	glBegin(GL_QUADS);
+	for(i = 0; i < num; ++i) {
+		if(tile_refs[i].slot >= 0) {
+			Disp_CompositeTile(tile_refs[i].slot, x, (int)floor(y - h*i));
+		}
+	}
+	glEnd();
+
+	glDisable(GL_TEXTURE_2D);
+
+	for(i = 0; i < num; ++i) {
+		if(tile_refs[i].slot < 0) {
+			Fnt_Print(fnt_reg, Line_Text(tile_refs[i].line), x, (int)floor(y - h*i),
+				i == 0 && show_cursor);
+		}
+	}
+}
+
+
+/**************************************************************************
+ * Page scrolling
+ *
+ * While scrolling, consecutive frames show the same text moved by a few
+ * pixels. The text of the last frame is kept in an offscreen page (as
+ * coverage, like the tiles); the next frame copies it shifted by the
+ * scroll delta into the other page and only draws the lines crossing
+ * the newly exposed band. The scroll offset is snapped to whole pixels
+ * so the copied part is exactly what a full redraw would have produced.
+ * Any edit, resize or font change redraws the whole page.
+ **************************************************************************/
+
+static GLuint page_tex[2];
+static GLuint page_fbo[2];
+static int page_cur = 0;
+static int page_w = 0;
+static int page_h = 0;
+static int page_tex_w = 0;
+static int page_tex_h = 0;
+static int pages_broken = 0;
+static int page_valid = 0;
+static unsigned long page_stamp = 0;
+static float page_fnt_size = 0.0f;
+static int page_x = 0;
+static int page_off = 0;
+static int page_cursor = 0;
+
+static
+void
+Disp_DestroyPages()
+{
+	if(page_w) {
+		glDeleteTextures(2, page_tex);
+		cs_glDeleteFramebuffers(2, page_fbo);
+	}
+
+	page_w = 0;
+	page_h = 0;
+	page_valid = 0;
+}
+
+static
+int
+Disp_InitPages()
+{
+	GLint max_size = 0;
+	int complete = 1;
+	int i;
+
+	if(pages_broken) {
+		return 0;
+	}
+
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+
+	page_tex_w = NextP2(disp_w);
+	page_tex_h = NextP2(disp_h);
+
+	if(page_tex_w > max_size || page_tex_h > max_size) {
+		return 0;
+	}
+
+	glGenTextures(2, page_tex);
+	cs_glGenFramebuffers(2, page_fbo);
+
+	for(i = 0; i < 2; ++i) {
+		glBindTexture(GL_TEXTURE_2D, page_tex[i]);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, page_tex_w, page_tex_h, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+		cs_glBindFramebuffer(GL_FRAMEBUFFER, page_fbo[i]);
+		cs_glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, page_tex[i], 0);
+		complete = complete && (cs_glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+	}
+
+	cs_glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	page_w = disp_w;
+	page_h = disp_h;
+	page_valid = 0;
+
+	if(!complete) {
+		Disp_DestroyPages();
+		pages_broken = 1;
+		return 0;
+	}
+
+	return 1;
+}
+
+// draws the bound page over the window, moved down by dy pixels
+static
+void
+Disp_DrawPage(int dy)
+{
+	float s = (float)page_w / page_tex_w;
+	float t = (float)page_h / page_tex_h;
+
+	glBegin(GL_QUADS);
+		glTexCoord2f(0.0f, t); glVertex2f(0, dy);
+		glTexCoord2f(s, t); glVertex2f(page_w, dy);
+		glTexCoord2f(s, 0.0f); glVertex2f(page_w, dy + page_h);
+		glTexCoord2f(0.0f, 0.0f); glVertex2f(0, dy + page_h);
+	glEnd();
+}
+
+// Like Disp_PrintFrame, but line k (counting up from the end of the
+// frame) has its baseline at off + floor(y - h*k), so changing off by
+// whole pixels moves every line by exactly that much. Returns 0 if
+// pages can't be used, and nothing was drawn.
+static
+int
+Disp_PagedFrame(Frame * frm, int x, float y, int off, int first_line, int max_lines, int show_cursor)
+{
+	float h = Fnt_LineHeight(fnt_reg) * 1.55 * Fnt_Width(fnt_reg);
+	int band0 = 0;
+	int band1 = disp_h;
+	int next = page_cur;
+	int delta = 0;
+	int num = 0;
+	int i;
+	Line * cur_line;
+
+	if(!Disp_TilesReady()) {
+		return 0;
+	}
+
+	if(page_w && (page_w != disp_w || page_h != disp_h)) {
+		Disp_DestroyPages();
+	}
+
+	if(!page_w && !Disp_InitPages()) {
+		return 0;
+	}
+
+	if(page_valid && page_stamp == Frame_Stamp(frm) && page_x == x &&
+		page_cursor == show_cursor && page_fnt_size == Fnt_Size(fnt_reg)) {
+		delta = off - page_off;
+
+		if(delta == 0) {
+			band1 = 0;
+		} else if(delta > 0 && delta < disp_h) {
+			band1 = delta;
+			next = !page_cur;
+		} else if(delta < 0 && -delta < disp_h) {
+			band0 = disp_h + delta;
+			next = !page_cur;
+		} else {
+			delta = 0;
+		}
+	}
+
+	if(band1 > band0) {
+		if(tile_refs_size < max_lines) {
+			tile_refs_size = max_lines;
+			tile_refs = (tile_ref_t *)realloc(tile_refs, tile_refs_size * sizeof(tile_ref_t));
+		}
+
+		++tile_frame;
+
+		// tiles for the lines crossing the band (-2: not drawn)
+		Frame_IterEnd(frm);
+
+		while(num < max_lines && (cur_line = Frame_IterPrev(frm))) {
+			int top = off + (int)floor(y - h*(first_line - 1 + num)) - tile_ascent;
+			int slot = -2;
+
+			// the line being typed on is drawn over the page
+			if(!(num == 0 && show_cursor) && top < band1 && top + tile_h > band0) {
+				slot = Disp_TileFor(cur_line);
+			}
+
+			tile_refs[num].line = cur_line;
+			tile_refs[num].slot = slot;
+			++num;
+		}
+
+		cs_glBindFramebuffer(GL_FRAMEBUFFER, page_fbo[next]);
+
+		glPushAttrib(GL_VIEWPORT_BIT | GL_SCISSOR_BIT | GL_COLOR_BUFFER_BIT | GL_ENABLE_BIT | GL_CURRENT_BIT);
+		glViewport(0, 0, disp_w, disp_h);
+
+		glMatrixMode(GL_PROJECTION);
+		glPushMatrix();
+		glLoadIdentity();
+		gluOrtho2D(0, disp_w, disp_h, 0);
+		glMatrixMode(GL_MODELVIEW);
+		glPushMatrix();
+		glLoadIdentity();
+
+		glClearColor(1.0f, 1.0f, 1.0f, 0.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+
+		glDisable(GL_DEPTH_TEST);
+		glEnable(GL_TEXTURE_2D);
+		glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+
+		if(next != page_cur) {
+			// the copy leaves exactly the band cleared
+			glDisable(GL_BLEND);
+			glBindTexture(GL_TEXTURE_2D, page_tex[page_cur]);
+			Disp_DrawPage(delta);
+		}
+
+		glEnable(GL_SCISSOR_TEST);
+		glScissor(0, disp_h - band1, disp_w, band1 - band0);
+
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_TRUE);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+		glBindTexture(GL_TEXTURE_2D, tile_tex);
+
+		glBegin(GL_QUADS);
+		for(i = 0; i < num; ++i) {
+			if(tile_refs[i].slot >= 0) {
+				Disp_CompositeTile(tile_refs[i].slot, x,
+					off + (int)floor(y - h*(first_line - 1 + i)));
+			}
+		}
+		glEnd();
+
+		for(i = 0; i < num; ++i) {
+			if(tile_refs[i].slot == -1) {
+				Fnt_DrawText(fnt_reg, Line_Text(tile_refs[i].line), x,
+					off + (int)floor(y - h*(first_line - 1 + i)));
+			}
+		}
+
+		glPopMatrix();
+		glMatrixMode(GL_PROJECTION);
+		glPopMatrix();
+		glMatrixMode(GL_MODELVIEW);
+
+		glPopAttrib();
+
+		cs_glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	page_cur = next;
+	page_valid = 1;
+	page_stamp = Frame_Stamp(frm);
+	page_fnt_size = Fnt_Size(fnt_reg);
+	page_x = x;
+	page_off = off;
+	page_cursor = show_cursor;
+
+	glEnable(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, page_tex[page_cur]);
+	Disp_DrawPage(0);
+	glDisable(GL_TEXTURE_2D);
+
+	if(show_cursor) {
+		Frame_IterEnd(frm);
+		cur_line = Frame_IterPrev(frm);
+		Fnt_Print(fnt_reg, Line_Text(cur_line), x, off + (int)floor(y), 1);
+	}
+
+	return 1;
+}
+
+
 #define DISP_LINE_PADDING 2
 
 //Frame is passed in, since input needs to deal with the Frame
@@ -250,9 +871,11 @@ Disp_TypingScreen(Frame * frm, scrolling_t * scroll)
 	float line_height = Fnt_LineHeight(fnt_reg) * 1.55 * fnt_width;
 
 	float disp_x = (int)((disp_w - (CHARS_PER_LINE*fnt_width)) / 2);
-	float disp_y = 5 + disp_h / 2;
+	float base_y = PX(5) + disp_h / 2;
+	float disp_y;
 
 	int num_lines;
+	int off;
 	int first_line;
 	int show_cursor;
 	double scroll_amt;
@@ -277,29 +900,33 @@ Disp_TypingScreen(Frame * frm, scrolling_t * scroll)
 	
 	// scroll the display appropriately, minus the part that isn't viewable
 	// NOTE: (0, 0) in screen coords is now the top left of the window
-	disp_y = disp_y - line_height * (-scroll_amt + first_line - 1);
+	disp_y = base_y - line_height * (-scroll_amt + first_line - 1);
+	off = (int)floor(line_height * scroll_amt + 0.5);
 
-	glPushMatrix();
-		if(save_anim) {
-			int x = disp_w - (disp_x / 2) - 22;
-			int y = disp_h - (int)round(save_anim_amt);
+	if(save_anim) {
+		int x = disp_w - (disp_x / 2) - PX(22);
+		int y = disp_h - (int)round(PX(save_anim_amt));
 
-			glPushMatrix();
-			glLoadIdentity();
+		DRAWING_COLOR
+		Disp_DrawSaveIcon(x, y);
+	}
 
-			PushScreenCoordMat();
+	TEXT_COLOR
+	if(!Disp_PagedFrame(frm, disp_x, base_y, off, first_line,
+		num_lines + DISP_LINE_PADDING, show_cursor)) {
+		Disp_PrintFrame(frm, disp_x, disp_y, num_lines + DISP_LINE_PADDING, show_cursor);
+	}
 
-			DRAWING_COLOR
-			Disp_DrawSaveIcon(x, y);
+	//the counts, down in the bottom left corner
+	{
+		frame_stats_t stats = Frame_Stats(frm);
+		char buf[96];
 
-			PopScreenCoordMat();
-			glPopMatrix();
-		}
+		sprintf(buf, "%ld words  %ld chars  %ld lines", stats.words, stats.chars, stats.lines);
 
-		TEXT_COLOR
-		glLoadIdentity();
-		Fnt_PrintFrame(fnt_reg, frm, disp_x, disp_y, num_lines + DISP_LINE_PADDING, show_cursor);
-	glPopMatrix();
+		DRAWING_COLOR
+		Fnt_Print(fnt_reg, buf, PX(20), disp_h - PX(20), 0);
+	}
 }
 
 static
@@ -331,7 +958,7 @@ Disp_DrawSaveIcon(int x, int y)
 
 	glPushMatrix();
 	glTranslatef(x, y, 0.0f);
-	glScalef(0.4f, 0.4f, 1.0f);
+	glScalef(PX(0.4f), PX(0.4f), 1.0f);
 
 	glBegin(GL_QUADS);
 		// left side
@@ -395,8 +1022,8 @@ static
 void
 Disp_DrawInputBox(int left, int right, int middle)
 {
-	static const int BOX_TOP = 32;
-	static const int BOX_BOT = 14;
+	const int BOX_TOP = PX(32);
+	const int BOX_BOT = PX(14);
 
 	glPushAttrib(GL_POLYGON_BIT);
 	glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
@@ -419,26 +1046,17 @@ Disp_SaveScreen(char * filename, int err)
 	float disp_x = (int)((disp_w - (CHARS_PER_LINE*Fnt_Width(fnt_reg))) / 2);
 	float disp_y = disp_h / 2;
 	
-	glPushMatrix();
-		glLoadIdentity();
-
-		PushScreenCoordMat();
-
-		if(err) {
-			ERR_COLOR
-		} else {
-			DRAWING_COLOR
-		}
-
-		Disp_DrawSaveIcon(disp_x, disp_y - 84 - (int)round(save_err_anim_amt));
-		Disp_DrawInputBox(disp_x, disp_w - disp_x, disp_y);
+	if(err) {
+		ERR_COLOR
+	} else {
+		DRAWING_COLOR
+	}
 
-		PopScreenCoordMat();
-		
-		TEXT_COLOR
-		Fnt_Print(fnt_reg, filename, disp_x + 10, disp_y, 1);
-		
-	glPopMatrix();
+	Disp_DrawSaveIcon(disp_x, disp_y - PX(84) - (int)round(PX(save_err_anim_amt)));
+	Disp_DrawInputBox(disp_x, disp_w - disp_x, disp_y);
+	
+	TEXT_COLOR
+	Fnt_Print(fnt_reg, filename, disp_x + PX(10), disp_y, 1);
 }
 
 static
@@ -446,15 +1064,15 @@ void
 Disp_DrawOpenCursor(int x, int y)
 {
 	int x1 = x;
-	int x2 = x1 + 15;
+	int x2 = x1 + PX(15);
 	int y1 = y;
-	int y2 = y1 + 24;
+	int y2 = y1 + PX(24);
 	
 	glBegin(GL_POLYGON);
 		glVertex2f(x1, y1);
 		glVertex2f(x1, y2);
 		glVertex2f(x2, y2);
-		glVertex2f(x2 + 11, y1 + 24.0/2.0);
+		glVertex2f(x2 + PX(11), y1 + PX(24.0/2.0));
 		glVertex2f(x2, y1);
 		glVertex2f(x1, y1);
 	glEnd();
@@ -465,21 +1083,21 @@ void
 Disp_DrawOpenIcon(int x, int y)
 {
 	int x1 = x;
-	int x2 = x1 + 40;
+	int x2 = x1 + PX(40);
 	
 	//the top of the box
 	int y1 = y;
-	int y2 = y1 + 6;
+	int y2 = y1 + PX(6);
 	
 	//actual box part
-	int y3 = y2 + 2;
-	int y4 = y1 + 38;
+	int y3 = y2 + PX(2);
+	int y4 = y1 + PX(38);
 	
 	//the handle part
-	int x3 = x1 + 12;
-	int x4 = x2 - 12;
-	int y5 = y1 + 6 * 3;
-	int y6 = y5 + 4;
+	int x3 = x1 + PX(12);
+	int x4 = x2 - PX(12);
+	int y5 = y1 + PX(6 * 3);
+	int y6 = y5 + PX(4);
 	
 	glBegin(GL_QUADS);
 		glVertex2f(x1, y1);
@@ -502,85 +1120,159 @@ Disp_DrawOpenIcon(int x, int y)
 }
 
 void
-Disp_OpenScreen(files_t * files, scrolling_t * scroll)
+Disp_OpenScreen(files_t * files, char * filter, scrolling_t * scroll)
 {
 	float disp_x = (int)((disp_w - (CHARS_PER_LINE*Fnt_Width(fnt_reg))) / 2);
-	int line_height = 40;
+	int line_height = PX(OPEN_SCREEN_LINE_HEIGHT);
 	int num_lines = (int)ceil(disp_h / line_height) - 6;
-	int heading_h = 112;
-	int start_h = heading_h + 46;
+	int heading_h = PX(112);
+	int start_h = heading_h + PX(46);
+	int cursor_h = PX(138);
 	float scroll_amt = scroll->amt * line_height;
-	int open_cursor_x = (int)(disp_x - 36 - open_err_anim_amt);
+	float list_shift = 0.0f;
+	int open_cursor_x = (int)(disp_x - PX(36 + open_err_anim_amt));
 
 	
 	glPushMatrix();
-		glLoadIdentity();
 
-		PushScreenCoordMat();
-		
-		glPushMatrix();
+		if(files->len > 0) {
+			if(open_err_anim) {
+				ERR_COLOR
+			} else {
+				DRAWING_COLOR
+			}
+	
+			if((int)ceil(scroll->amt) > num_lines) {
+				scroll_amt = (int)ceil((scroll->amt - num_lines)*line_height);
+				list_shift = scroll_amt;
+				Disp_DrawOpenCursor(open_cursor_x, cursor_h + num_lines*line_height);
+				glTranslatef(0.0f, -scroll_amt /* ceil((scroll->amt - num_lines)*line_height) */, 0.0f);
+			} else {
+				Disp_DrawOpenCursor(open_cursor_x, cursor_h + scroll_amt);
+			}
+		}
 
-			if(files->len > 0) {
-				if(open_err_anim) {
-					ERR_COLOR
-				} else {
-					DRAWING_COLOR
-				}
-		
-				if((int)ceil(scroll->amt) > num_lines) {
-					scroll_amt = (int)ceil((scroll->amt - num_lines)*line_height);
-					Disp_DrawOpenCursor(open_cursor_x, 138 + num_lines*line_height);
-					glTranslatef(0.0f, -scroll_amt /* ceil((scroll->amt - num_lines)*line_height) */, 0.0f);
-				} else {
-					Disp_DrawOpenCursor(open_cursor_x, 138 + scroll_amt);
-				}
+		TEXT_COLOR
+
+		//print files, all under one texture enable
+		if(files->len == 0) {
+			Fnt_Print(fnt_reg, *filter ? "No matches." : "No files.", disp_x, start_h, 0);
+		} else {
+			// only the names that land in the window (the heading box
+			// covers the ones above it)
+			int first = (int)((list_shift - start_h) / line_height);
+			int last = (int)((list_shift + disp_h - start_h) / line_height) + 2;
+			int i;
+
+			if(first < 0) {
+				first = 0;
+			}
+			if(last > files->len) {
+				last = files->len;
+			}
+
+			glEnable(GL_TEXTURE_2D);
+			for(i = first; i < last; ++i) {
+				Fnt_DrawText(fnt_reg, files->names[i], disp_x, start_h + line_height*i);
 			}
 
-			TEXT_COLOR
+			//then how long each one is, right aligned, where it fits
+			DRAWING_COLOR
+			for(i = first; i < last; ++i) {
+				meta_t meta;
+				char buf[32];
 
-			//print files
-			if(files->len == 0) {
-				Fnt_Print(fnt_reg, "No files.", disp_x, start_h, 0);
-			} else {
-				int i;
-				for(i = 0; i < files->len; ++i) {
-					Fnt_Print(fnt_reg, files->names[i], disp_x, start_h + line_height*i, 0);
+				if(!Meta_Get(files->names[i], &meta)) {
+					continue;
+				}
+
+				sprintf(buf, "%u words", meta.words);
+
+				if(utflen(files->names[i]) + (int)strlen(buf) + 2 <= CHARS_PER_LINE) {
+					Fnt_DrawText(fnt_reg, buf, disp_w - disp_x - strlen(buf)*Fnt_Width(fnt_reg),
+						start_h + line_height*i);
 				}
 			}
-		
-		glPopMatrix();
-		
-		BG_COLOR
-			
-		//draw a box so that any scrolling lines go under it
-		glBegin(GL_QUADS);
-			glVertex2f(disp_x, 0);
-			glVertex2f(disp_x, heading_h + 12);
-			glVertex2f(disp_w - disp_x, heading_h + 12);
-			glVertex2f(disp_w - disp_x, 0);
-		glEnd();
-		
-		DRAWING_COLOR
-		
-		//draw a line for the heading
-		glBegin(GL_LINES);
-			glVertex2f(disp_x, heading_h);
-			glVertex2f(disp_w - disp_x, heading_h);
-		glEnd();
-		
-		Disp_DrawOpenIcon(disp_x, heading_h - 50);
-		
-		PopScreenCoordMat();
+			glDisable(GL_TEXTURE_2D);
+		}
+	
 	glPopMatrix();
+	
+	BG_COLOR
+		
+	//draw a box so that any scrolling lines go under it
+	glBegin(GL_QUADS);
+		glVertex2f(disp_x, 0);
+		glVertex2f(disp_x, heading_h + PX(12));
+		glVertex2f(disp_w - disp_x, heading_h + PX(12));
+		glVertex2f(disp_w - disp_x, 0);
+	glEnd();
+	
+	DRAWING_COLOR
+	
+	//draw a line for the heading
+	glBegin(GL_LINES);
+		glVertex2f(disp_x, heading_h);
+		glVertex2f(disp_w - disp_x, heading_h);
+	glEnd();
+	
+	Disp_DrawOpenIcon(disp_x, heading_h - PX(50));
+	
+	//what's been typed to filter the list, next to the icon
+	TEXT_COLOR
+	Fnt_Print(fnt_reg, filter, disp_x + PX(64), heading_h - PX(18), 1);
+}
+
+
+void
+Disp_Progress(char * label, int done, int total)
+{
+	float disp_x = (int)((disp_w - (CHARS_PER_LINE*Fnt_Width(fnt_reg))) / 2);
+	int heading_h = PX(112);
+	float frac = (total > 0) ? (float)done / total : 0.0f;
+	char buf[96];
+
+	//fill in the heading line as the work gets done
+	DRAWING_COLOR
+	glBegin(GL_QUADS);
+		glVertex2f(disp_x, heading_h - PX(1));
+		glVertex2f(disp_x, heading_h + PX(2));
+		glVertex2f(disp_x + frac*(disp_w - 2*disp_x), heading_h + PX(2));
+		glVertex2f(disp_x + frac*(disp_w - 2*disp_x), heading_h - PX(1));
+	glEnd();
+
+	sprintf(buf, "%.60s %d / %d", label, done, total);
+
+	TEXT_COLOR
+	Fnt_Print(fnt_reg, buf, disp_x, disp_h - PX(24), 0);
+}
+
+
+void
+Disp_Status(char * text)
+{
+	//right aligned in the bottom right corner, across from the counts
+	int x = (int)(disp_w - PX(20) - utflen(text)*Fnt_Width(fnt_reg));
+
+	DRAWING_COLOR
+	Fnt_Print(fnt_reg, text, x, disp_h - PX(20), 0);
+}
+
+
+void
+Disp_Note(char * text)
+{
+	//in the bottom left corner, under the list
+	float disp_x = (int)((disp_w - (CHARS_PER_LINE*Fnt_Width(fnt_reg))) / 2);
+
+	DRAWING_COLOR
+	Fnt_Print(fnt_reg, text, disp_x, disp_h - PX(24), 0);
 }
 
 
 void
 Disp_Resize(int w, int h)
 {
-	// height and width ratio
-    GLfloat ratio;
- 
     // protect against a divide by zero
 	if(h == 0) {
 		h = 1;
@@ -589,12 +1281,6 @@ Disp_Resize(int w, int h)
 	disp_h = h;
 	disp_w = w;
 
-    ratio = (GLfloat)w / (GLfloat)h;
-
+    // the projection is set up per frame by Disp_BeginRender
     glViewport(0, 0, (GLsizei)w, (GLsizei)h);
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    gluPerspective(45.0f, ratio, 0.1f, 100.0f);
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
 }
@@ -32,6 +32,12 @@ Disp_Init(int fnt_size);
 void
 Disp_Destroy();
 
+void
+Disp_SetScale(float scale);
+
+float
+Disp_Scale();
+
 void
 Disp_BeginRender();
 
@@ -57,7 +63,16 @@ void
 Disp_SaveScreen(char * filename, int error);
 
 void
-Disp_OpenScreen(files_t * files, scrolling_t * scroll);
+Disp_OpenScreen(files_t * files, char * filter, scrolling_t * scroll);
+
+void
+Disp_Progress(char * label, int done, int total);
+
+void
+Disp_Status(char * text);
+
+void
+Disp_Note(char * text);
 
 void
 Disp_Resize(int w, int h);
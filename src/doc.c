@@ -0,0 +1,432 @@
+/*************************************************************************
+ * doc.c -- Reads and writes documents, compressed or not.
+ *
+ * Candlestick App: Just Write. A minimalist, cross-platform writing app.
+ * Copyright (C) 2013 Thomas Klemz
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************************/
+
+#include "doc.h"
+#include "files.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef DOC_PACKED
+#  include <zlib.h>
+#  include <bzlib.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#  include <unistd.h>
+#elif defined(_WIN32)
+#  include <io.h>
+#endif
+
+// what's read from disk at a time, and the gzip level (zlib's default)
+#define READ_CHUNK (64 * 1024)
+#define GZ_MODE "wb6"
+
+struct doc_writer_tag {
+	doc_pack_t pack;
+	FILE * file;
+#ifdef DOC_PACKED
+	gzFile gz;
+	BZFILE * bz;
+#endif
+	long end;       // where a reopened file is cut off (-1 if not)
+	int ok;
+};
+
+
+static
+int
+Doc_EndsWith(char * name, const char * ext)
+{
+	size_t len = strlen(name);
+	size_t ext_len = strlen(ext);
+
+	return len > ext_len && !strcmp(name + len - ext_len, ext);
+}
+
+doc_pack_t
+Doc_Packing(char * name)
+{
+#ifdef DOC_PACKED
+	if(Doc_EndsWith(name, DOC_EXT_GZ)) {
+		return DOC_GZIP;
+	}
+	if(Doc_EndsWith(name, DOC_EXT_BZ2)) {
+		return DOC_BZIP2;
+	}
+#endif
+	return DOC_PLAIN;
+}
+
+int
+Doc_PackExtLen(char * name)
+{
+	switch(Doc_Packing(name)) {
+	case DOC_GZIP:  return (int)strlen(DOC_EXT_GZ);
+	case DOC_BZIP2: return (int)strlen(DOC_EXT_BZ2);
+	default:        return 0;
+	}
+}
+
+
+/**************************************************************************
+ * Reading
+ **************************************************************************/
+
+// makes room for at least READ_CHUNK more bytes
+static
+char *
+Doc_Grow(char * buf, long len, long * cap)
+{
+	if(*cap - len < READ_CHUNK) {
+		char * grown;
+
+		*cap = *cap * 2 > len + READ_CHUNK ? *cap * 2 : len + READ_CHUNK;
+		grown = (char *)realloc(buf, *cap);
+
+		if(!grown) {
+			free(buf);
+		}
+
+		return grown;
+	}
+
+	return buf;
+}
+
+static
+char *
+Doc_ReadPlain(char * path, long * len)
+{
+	FILE * file = fopen(path, "rb");
+	char * buf;
+	long size;
+
+	if(!file) {
+		return 0;
+	}
+
+	fseek(file, 0, SEEK_END);
+	size = ftell(file);
+	rewind(file);
+
+	buf = (char *)malloc(size + 1);
+
+	if(buf && (long)fread(buf, 1, size, file) != size) {
+		free(buf);
+		buf = 0;
+	}
+
+	fclose(file);
+	*len = size;
+
+	return buf;
+}
+
+#ifdef DOC_PACKED
+static
+char *
+Doc_ReadGzip(char * path, long * len)
+{
+	gzFile gz = gzopen(path, "rb");
+	char * buf = 0;
+	long cap = 0;
+	int n = 0;
+
+	if(!gz) {
+		return 0;
+	}
+
+	gzbuffer(gz, READ_CHUNK);
+	*len = 0;
+
+	while((buf = Doc_Grow(buf, *len, &cap)) &&
+		(n = gzread(gz, buf + *len, (unsigned)(cap - *len))) > 0) {
+		*len += n;
+	}
+
+	if(n < 0 && buf) {
+		fprintf(stderr, "Could not unpack %s: %s\n", path, gzerror(gz, &n));
+		free(buf);
+		buf = 0;
+	}
+
+	gzclose(gz);
+
+	return buf;
+}
+
+static
+char *
+Doc_ReadBzip2(char * path, long * len)
+{
+	FILE * file = fopen(path, "rb");
+	char unused[BZ_MAX_UNUSED];
+	int num_unused = 0;
+	char * buf = 0;
+	long cap = 0;
+	int err = BZ_OK;
+
+	if(!file) {
+		return 0;
+	}
+
+	*len = 0;
+
+	// a file can hold several streams one after another (parallel
+	// compressors make those), each one opened where the last ended
+	for(;;) {
+		BZFILE * bz = BZ2_bzReadOpen(&err, file, 0, 0, unused, num_unused);
+		int close_err;
+		void * rest;
+
+		if(!bz) {
+			break;
+		}
+
+		while(err == BZ_OK && (buf = Doc_Grow(buf, *len, &cap))) {
+			int n = BZ2_bzRead(&err, bz, buf + *len, (int)(cap - *len));
+
+			if(err == BZ_OK || err == BZ_STREAM_END) {
+				*len += n;
+			}
+		}
+
+		if(err == BZ_STREAM_END) {
+			BZ2_bzReadGetUnused(&err, bz, &rest, &num_unused);
+			memcpy(unused, rest, num_unused);
+		}
+
+		BZ2_bzReadClose(&close_err, bz);
+
+		if(err != BZ_OK || !buf) {
+			break;
+		}
+
+		if(num_unused == 0) {
+			int c = fgetc(file);
+
+			if(c == EOF) {
+				break;
+			}
+
+			ungetc(c, file);
+		}
+	}
+
+	fclose(file);
+
+	if(err != BZ_OK && buf) {
+		fprintf(stderr, "Could not unpack %s (bzip2 error %d)\n", path, err);
+		free(buf);
+		buf = 0;
+	}
+
+	return buf;
+}
+#endif
+
+char*
+Doc_Read(char * name, long * len)
+{
+	char * path = Files_GetAbsPath(name);
+	char * buf;
+
+	switch(Doc_Packing(name)) {
+#ifdef DOC_PACKED
+	case DOC_GZIP:
+		buf = Doc_ReadGzip(path, len);
+		break;
+	case DOC_BZIP2:
+		buf = Doc_ReadBzip2(path, len);
+		break;
+#endif
+	default:
+		buf = Doc_ReadPlain(path, len);
+		break;
+	}
+
+	free(path);
+
+	return buf;
+}
+
+
+/**************************************************************************
+ * Writing
+ **************************************************************************/
+
+doc_writer_t*
+Doc_Create(char * name)
+{
+	char * path = Files_GetAbsPath(name);
+	doc_writer_t * w = (doc_writer_t *)calloc(1, sizeof(doc_writer_t));
+
+	w->pack = Doc_Packing(name);
+	w->end = -1;
+	w->ok = 1;
+
+	switch(w->pack) {
+#ifdef DOC_PACKED
+	case DOC_GZIP:
+		w->gz = gzopen(path, GZ_MODE);
+		w->ok = (w->gz != 0);
+		break;
+	case DOC_BZIP2:
+	{
+		int err;
+
+		w->file = fopen(path, "wb");
+		w->bz = w->file ? BZ2_bzWriteOpen(&err, w->file, 9, 0, 0) : 0;
+		w->ok = (w->bz != 0);
+		break;
+	}
+#endif
+	default:
+		w->file = fopen(path, "wb");
+		w->ok = (w->file != 0);
+		break;
+	}
+
+	free(path);
+
+	if(!w->ok) {
+		Doc_Close(w);
+		return 0;
+	}
+
+	return w;
+}
+
+doc_writer_t*
+Doc_Reopen(char * name, long from)
+{
+	char * path;
+	doc_writer_t * w;
+	FILE * file;
+
+	if(Doc_Packing(name) != DOC_PLAIN) {
+		return 0;
+	}
+
+	path = Files_GetAbsPath(name);
+	file = fopen(path, "r+b");
+	free(path);
+
+	if(!file) {
+		return 0;
+	}
+
+	// only write over what's really there
+	if(fseek(file, 0, SEEK_END) || ftell(file) < from || fseek(file, from, SEEK_SET)) {
+		fclose(file);
+		return 0;
+	}
+
+	w = (doc_writer_t *)calloc(1, sizeof(doc_writer_t));
+	w->pack = DOC_PLAIN;
+	w->file = file;
+	w->end = from;
+	w->ok = 1;
+
+	return w;
+}
+
+static
+int
+Doc_Truncate(FILE * file, long size)
+{
+	if(fflush(file)) {
+		return 0;
+	}
+
+#if defined(__unix__) || defined(__APPLE__)
+	return ftruncate(fileno(file), size) == 0;
+#elif defined(_WIN32)
+	return _chsize_s(_fileno(file), size) == 0;
+#endif
+}
+
+int
+Doc_Write(void * writer, const char * buf, int len)
+{
+	doc_writer_t * w = (doc_writer_t *)writer;
+
+	if(!w->ok || len <= 0) {
+		return w->ok;
+	}
+
+	switch(w->pack) {
+#ifdef DOC_PACKED
+	case DOC_GZIP:
+		w->ok = (gzwrite(w->gz, buf, (unsigned)len) == len);
+		break;
+	case DOC_BZIP2:
+	{
+		int err;
+
+		BZ2_bzWrite(&err, w->bz, (void *)buf, len);
+		w->ok = (err == BZ_OK);
+		break;
+	}
+#endif
+	default:
+		w->ok = (fwrite(buf, 1, len, w->file) == (size_t)len);
+		if(w->end >= 0) {
+			w->end += len;
+		}
+		break;
+	}
+
+	return w->ok;
+}
+
+int
+Doc_Close(doc_writer_t * w)
+{
+	int ok = w->ok;
+
+#ifdef DOC_PACKED
+	if(w->gz) {
+		ok = (gzclose(w->gz) == Z_OK) && ok;
+	}
+
+	if(w->bz) {
+		int err;
+
+		BZ2_bzWriteClose(&err, w->bz, !ok, 0, 0);
+		ok = (err == BZ_OK) && ok;
+	}
+#endif
+
+	// a reopened file may have been longer than what's there now
+	if(w->end >= 0 && ok) {
+		ok = Doc_Truncate(w->file, w->end);
+	}
+
+	if(w->file) {
+		ok = (fclose(w->file) == 0) && ok;
+	}
+
+	free(w);
+
+	return ok;
+}
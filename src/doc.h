@@ -0,0 +1,93 @@
+/*************************************************************************
+ * doc.h -- Reads and writes documents, compressed or not.
+ *
+ * Candlestick App: Just Write. A minimalist, cross-platform writing app.
+ * Copyright (C) 2013 Thomas Klemz
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************************/
+
+#ifndef CS_DOC_H
+#define CS_DOC_H
+
+// documents named name.txt.gz or name.txt.bz2 are kept compressed
+// (not on Windows, which has no zlib or bzip2 to link)
+#if !defined(_WIN32)
+#  define DOC_PACKED 1
+#endif
+
+#define DOC_EXT_GZ ".gz"
+#define DOC_EXT_BZ2 ".bz2"
+
+typedef enum {
+	DOC_PLAIN,
+	DOC_GZIP,
+	DOC_BZIP2
+} doc_pack_t;
+
+typedef struct doc_writer_tag doc_writer_t;
+
+
+// how a document is stored, by its name's extension
+doc_pack_t
+Doc_Packing(char * name);
+
+// the length of the packing extension at the end of name (0 if plain)
+int
+Doc_PackExtLen(char * name);
+
+
+/**************************************************************************
+ * Read
+ *
+ * Returns the whole document (name with extension, in DOCS_FOLDER) as
+ * a malloc'd buffer of *len bytes, decompressed as it's read. 0 if it
+ * couldn't be read.
+ **************************************************************************/
+
+char*
+Doc_Read(char * name, long * len);
+
+
+/**************************************************************************
+ * Create / Write / Close
+ *
+ * Writes a document, compressing as it goes if its name asks for it.
+ * Doc_Write has the shape Frame_Write wants; Doc_Close returns 0 if
+ * anything along the way failed.
+ **************************************************************************/
+
+doc_writer_t*
+Doc_Create(char * name);
+
+int
+Doc_Write(void * writer, const char * buf, int len);
+
+
+/**************************************************************************
+ * Reopen
+ *
+ * Opens a plain document to write over it from byte from on, leaving
+ * what comes before alone; Doc_Close cuts it off where the writing
+ * stopped. 0 if it's packed (those are always written whole) or isn't
+ * there with at least from bytes, so it should be created instead.
+ **************************************************************************/
+
+doc_writer_t*
+Doc_Reopen(char * name, long from);
+
+int
+Doc_Close(doc_writer_t * writer);
+
+#endif
@@ -0,0 +1,379 @@
+/*************************************************************************
+ * enc.c -- Detects and converts the encodings of imported text.
+ *
+ * Candlestick App: Just Write. A minimalist, cross-platform writing app.
+ * Copyright (C) 2013 Thomas Klemz
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************************/
+
+#include "enc.h"
+#include "utf.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || \
+	(defined(__i386__) && defined(__SSE2__)) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define ENC_SSE2 1
+#  include <emmintrin.h>
+#endif
+
+// how much of the start of a file the UTF-16 guess looks at
+#define SNIFF_LEN 4096
+
+// 0x80-0x9F in Windows-1252; the five it leaves undefined map to the
+// C1 controls, as Windows itself does
+static const unsigned short cp1252_high[32] = {
+	0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+	0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008D, 0x017D, 0x008F,
+	0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+	0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178
+};
+
+
+// counts the well formed multibyte characters and the bytes that
+// aren't part of one
+static
+void
+Enc_CountUtf8(const unsigned char * s, long len, long * good, long * bad)
+{
+	long i = 0;
+	int n;
+	Rune rune;
+
+	*good = 0;
+	*bad = 0;
+
+	while(i < len) {
+		if(s[i] < 0x80) {
+			++i;
+			continue;
+		}
+
+		n = fullrune((char *)s + i, (int)(len - i > UTFmax ? UTFmax : len - i)) ?
+			chartorune(&rune, (char *)s + i) : 0;
+
+		if(n <= 1) {
+			*bad += 1;
+			++i;
+		} else {
+			*good += 1;
+			i += n;
+		}
+	}
+}
+
+enc_t
+Enc_Detect(char * buf, long len)
+{
+	const unsigned char * s = (const unsigned char *)buf;
+	long n = len < SNIFF_LEN ? len : SNIFF_LEN;
+	long zeros[2] = {0, 0};
+	long good;
+	long bad;
+	long i;
+
+	if(len >= 3 && s[0] == 0xEF && s[1] == 0xBB && s[2] == 0xBF &&
+		utfvalid(buf + 3, len - 3)) {
+		return ENC_UTF8_BOM;
+	}
+	if(len >= 2 && s[0] == 0xFF && s[1] == 0xFE) {
+		return ENC_UTF16LE;
+	}
+	if(len >= 2 && s[0] == 0xFE && s[1] == 0xFF) {
+		return ENC_UTF16BE;
+	}
+
+	// mostly Latin script UTF-16 has a NUL in nearly every high byte
+	// (UTF-8 text never has NULs, so this comes first)
+	if(memchr(s, 0, n)) {
+		for(i = 0; i + 1 < n; i += 2) {
+			zeros[0] += (s[i] == 0);
+			zeros[1] += (s[i + 1] == 0);
+		}
+
+		if(zeros[1] > n / 4 && zeros[0] < n / 40) {
+			return ENC_UTF16LE;
+		}
+		if(zeros[0] > n / 4 && zeros[1] < n / 40) {
+			return ENC_UTF16BE;
+		}
+	}
+
+	if(utfvalid(buf, len)) {
+		return ENC_UTF8;
+	}
+
+	// UTF-8 that's had a byte or two go wrong is still UTF-8 (the odd
+	// accented letter in Windows-1252 is a bad byte on its own)
+	Enc_CountUtf8(s, len, &good, &bad);
+
+	return (good > 0 && bad <= good) ? ENC_UTF8_BAD : ENC_CP1252;
+}
+
+const char*
+Enc_Name(enc_t enc)
+{
+	switch(enc) {
+	case ENC_UTF8:     return "UTF-8";
+	case ENC_UTF8_BOM: return "UTF-8 (with BOM)";
+	case ENC_UTF8_BAD: return "UTF-8 (with invalid bytes)";
+	case ENC_UTF16LE:  return "UTF-16LE";
+	case ENC_UTF16BE:  return "UTF-16BE";
+	case ENC_CP1252:   return "Windows-1252";
+	}
+
+	return "?";
+}
+
+
+/**************************************************************************
+ * Converters
+ *
+ * Both go through ASCII a block at a time (16 bytes, or 8 UTF-16 code
+ * units, with SSE2; else one at a time) and only work out the rest one
+ * character at a time.
+ **************************************************************************/
+
+static
+unsigned char *
+Enc_Put(unsigned char * p, unsigned int c)
+{
+	if(c < 0x80) {
+		*p++ = (unsigned char)c;
+	} else if(c < 0x800) {
+		*p++ = (unsigned char)(0xC0 | (c >> 6));
+		*p++ = (unsigned char)(0x80 | (c & 0x3F));
+	} else if(c < 0x10000) {
+		*p++ = (unsigned char)(0xE0 | (c >> 12));
+		*p++ = (unsigned char)(0x80 | ((c >> 6) & 0x3F));
+		*p++ = (unsigned char)(0x80 | (c & 0x3F));
+	} else {
+		*p++ = (unsigned char)(0xF0 | (c >> 18));
+		*p++ = (unsigned char)(0x80 | ((c >> 12) & 0x3F));
+		*p++ = (unsigned char)(0x80 | ((c >> 6) & 0x3F));
+		*p++ = (unsigned char)(0x80 | (c & 0x3F));
+	}
+
+	return p;
+}
+
+// out has room for 3 bytes per byte of in; each byte that isn't part
+// of a well formed character becomes U+FFFD
+static
+long
+Enc_FromBadUtf8(const unsigned char * in, long len, unsigned char * out)
+{
+	unsigned char * p = out;
+	long i = 0;
+	int n;
+	Rune rune;
+
+	while(i < len) {
+#ifdef ENC_SSE2
+		while(len - i >= 16) {
+			__m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+
+			if(_mm_movemask_epi8(v)) {
+				break;
+			}
+
+			_mm_storeu_si128((__m128i *)p, v);
+			p += 16;
+			i += 16;
+		}
+
+		if(i >= len) {
+			break;
+		}
+#endif
+		if(in[i] < 0x80) {
+			*p++ = in[i++];
+			continue;
+		}
+
+		n = fullrune((char *)in + i, (int)(len - i > UTFmax ? UTFmax : len - i)) ?
+			chartorune(&rune, (char *)in + i) : 0;
+
+		if(n <= 1) {
+			p = Enc_Put(p, Runeerror);
+			++i;
+		} else {
+			memcpy(p, in + i, n);
+			p += n;
+			i += n;
+		}
+	}
+
+	return p - out;
+}
+
+// out has room for 3 bytes per byte of in
+static
+long
+Enc_FromCp1252(const unsigned char * in, long len, unsigned char * out)
+{
+	unsigned char * p = out;
+	long i = 0;
+
+	while(i < len) {
+#ifdef ENC_SSE2
+		while(len - i >= 16) {
+			__m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+
+			if(_mm_movemask_epi8(v)) {
+				break;
+			}
+
+			_mm_storeu_si128((__m128i *)p, v);
+			p += 16;
+			i += 16;
+		}
+
+		if(i >= len) {
+			break;
+		}
+#endif
+		if(in[i] < 0x80) {
+			*p++ = in[i];
+		} else if(in[i] < 0xA0) {
+			p = Enc_Put(p, cp1252_high[in[i] - 0x80]);
+		} else {
+			p = Enc_Put(p, in[i]);
+		}
+		++i;
+	}
+
+	return p - out;
+}
+
+// out has room for 3 bytes per code unit (a surrogate pair, two units,
+// makes 4)
+static
+long
+Enc_FromUtf16(const unsigned char * in, long len, int big_endian, unsigned char * out)
+{
+	unsigned char * p = out;
+	long units = len / 2;
+	long i = 0;
+	int lo = big_endian ? 1 : 0;
+	int hi = big_endian ? 0 : 1;
+
+	while(i < units) {
+		unsigned int c;
+
+#ifdef ENC_SSE2
+		while(units - i >= 8) {
+			__m128i v = _mm_loadu_si128((const __m128i *)(in + 2 * i));
+			__m128i high;
+
+			if(big_endian) {
+				v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+			}
+
+			// all 8 below 0x80?
+			high = _mm_and_si128(v, _mm_set1_epi16((short)0xFF80));
+			if(_mm_movemask_epi8(_mm_cmpeq_epi16(high, _mm_setzero_si128())) != 0xFFFF) {
+				break;
+			}
+
+			_mm_storel_epi64((__m128i *)p, _mm_packus_epi16(v, v));
+			p += 8;
+			i += 8;
+		}
+
+		if(i >= units) {
+			break;
+		}
+#endif
+		c = in[2 * i + lo] | (in[2 * i + hi] << 8);
+		++i;
+
+		if(c >= 0xD800 && c < 0xDC00 && i < units) {
+			unsigned int c2 = in[2 * i + lo] | (in[2 * i + hi] << 8);
+
+			if(c2 >= 0xDC00 && c2 < 0xE000) {
+				c = 0x10000 + ((c - 0xD800) << 10) + (c2 - 0xDC00);
+				++i;
+			}
+		}
+
+		// a surrogate that isn't half of a pair
+		if(c >= 0xD800 && c < 0xE000) {
+			c = Runeerror;
+		}
+
+		p = Enc_Put(p, c);
+	}
+
+	// an odd byte at the end
+	if(len & 1) {
+		p = Enc_Put(p, Runeerror);
+	}
+
+	return p - out;
+}
+
+
+char*
+Enc_ToUtf8(char * buf, long * len, enc_t * enc)
+{
+	const unsigned char * in = (const unsigned char *)buf;
+	unsigned char * out;
+	long n = *len;
+
+	*enc = Enc_Detect(buf, n);
+
+	switch(*enc) {
+	case ENC_UTF8:
+		return buf;
+	case ENC_UTF8_BOM:
+		memmove(buf, buf + 3, n - 3);
+		*len = n - 3;
+		return buf;
+	case ENC_UTF16LE:
+	case ENC_UTF16BE:
+	{
+		long skip = (n >= 2 && ((in[0] == 0xFF && in[1] == 0xFE) ||
+			(in[0] == 0xFE && in[1] == 0xFF))) ? 2 : 0;
+
+		out = (unsigned char *)malloc(3 * (n / 2) + 4);
+		if(out) {
+			*len = Enc_FromUtf16(in + skip, n - skip, *enc == ENC_UTF16BE, out);
+		}
+		break;
+	}
+	case ENC_UTF8_BAD:
+	{
+		long skip = (n >= 3 && in[0] == 0xEF && in[1] == 0xBB && in[2] == 0xBF) ? 3 : 0;
+
+		out = (unsigned char *)malloc(3 * n + 1);
+		if(out) {
+			*len = Enc_FromBadUtf8(in + skip, n - skip, out);
+		}
+		break;
+	}
+	default:
+		out = (unsigned char *)malloc(3 * n + 1);
+		if(out) {
+			*len = Enc_FromCp1252(in, n, out);
+		}
+		break;
+	}
+
+	free(buf);
+
+	return (char *)out;
+}
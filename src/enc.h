@@ -0,0 +1,66 @@
+/*************************************************************************
+ * enc.h -- Detects and converts the encodings of imported text.
+ *
+ * Candlestick App: Just Write. A minimalist, cross-platform writing app.
+ * Copyright (C) 2013 Thomas Klemz
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************************/
+
+#ifndef CS_ENC_H
+#define CS_ENC_H
+
+typedef enum {
+	ENC_UTF8,
+	ENC_UTF8_BOM,
+	ENC_UTF8_BAD,  // with a few bytes that aren't, each read as U+FFFD
+	ENC_UTF16LE,
+	ENC_UTF16BE,
+	ENC_CP1252     // and so Latin-1, which only differs in C1 controls
+} enc_t;
+
+
+/**************************************************************************
+ * Detect
+ *
+ * Goes by the byte order mark if there is one; otherwise text with
+ * NULs in every other byte is taken as UTF-16, valid UTF-8 as UTF-8,
+ * and mostly valid UTF-8 (a stray byte pasted in, or a write cut off
+ * mid-character) as UTF-8 with bad bytes. Only text with no more well
+ * formed multibyte characters than bad bytes is Windows-1252 (which
+ * can decode any bytes).
+ **************************************************************************/
+
+enc_t
+Enc_Detect(char * buf, long len);
+
+// a name for messages ("UTF-16LE" etc.)
+const char*
+Enc_Name(enc_t enc);
+
+
+/**************************************************************************
+ * ToUtf8
+ *
+ * Takes the malloc'd buf of *len bytes and returns it as UTF-8 (with
+ * no byte order mark), setting *len to the new length and *enc to what
+ * it was. UTF-8 comes back in the same buffer; anything else is
+ * converted into a new one and buf is freed. 0 if out of memory (buf
+ * is freed then too).
+ **************************************************************************/
+
+char*
+Enc_ToUtf8(char * buf, long * len, enc_t * enc);
+
+#endif
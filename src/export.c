@@ -0,0 +1,430 @@
+/*************************************************************************
+ * export.c -- Exports the documents folder as a .tar.bz2 archive.
+ *
+ * Candlestick App: Just Write. A minimalist, cross-platform writing app.
+ * Copyright (C) 2013 Thomas Klemz
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************************/
+
+#include "export.h"
+#include "doc.h"
+#include "thread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef DOC_PACKED
+#  include <bzlib.h>
+#  include <sys/stat.h>
+#endif
+
+
+#ifdef DOC_PACKED
+
+/**************************************************************************
+ * Blocks
+ *
+ * The tar stream is built up in BLOCK_SIZE pieces (bzip2's biggest
+ * block, so each piece is about one bzip2 block). Once a batch of them
+ * is full, the pool compresses them all at once and they're written
+ * out in order, so memory stays at one batch however big the folder.
+ **************************************************************************/
+
+#define BLOCK_SIZE 900000
+#define BLOCKS_PER_WORKER 2
+#define TAR_BLOCK 512
+
+typedef struct {
+	char * data;
+	unsigned int len;
+	char * packed;
+	unsigned int packed_len;
+	int ok;
+} export_block_t;
+
+typedef struct {
+	FILE * out;
+	export_block_t * blocks;
+	int num_blocks;            // full ones in the batch
+	int max_blocks;
+	int ok;
+} export_t;
+
+static cs_job_t export_job = {0};
+
+static char ** export_names = 0;
+static int export_num = 0;
+static char export_path[256];
+static int export_ok = 0;
+static int export_failed = 0;  // documents that couldn't be read
+
+static
+void
+Export_PackTask(int item, int worker, void * arg)
+{
+	export_block_t * block = &((export_t *)arg)->blocks[item];
+
+	// bzip2's worst case is 1% and 600 bytes over
+	block->packed_len = block->len + block->len / 100 + 601;
+	block->packed = (char *)malloc(block->packed_len);
+	block->ok = block->packed && BZ2_bzBuffToBuffCompress(block->packed,
+		&block->packed_len, block->data, block->len, 9, 0, 0) == BZ_OK;
+}
+
+// compresses the batch and writes it out
+static
+void
+Export_Flush(export_t * ex)
+{
+	int i;
+
+	// the last block of the batch may be part full
+	if(ex->num_blocks < ex->max_blocks && ex->blocks[ex->num_blocks].len > 0) {
+		++ex->num_blocks;
+	}
+
+	Pool_Run(ex->num_blocks, Export_PackTask, ex);
+
+	for(i = 0; i < ex->num_blocks; ++i) {
+		export_block_t * block = &ex->blocks[i];
+
+		ex->ok = ex->ok && block->ok &&
+			fwrite(block->packed, 1, block->packed_len, ex->out) == block->packed_len;
+
+		free(block->packed);
+		block->packed = 0;
+		block->len = 0;
+	}
+
+	ex->num_blocks = 0;
+}
+
+// appends to the tar stream
+static
+void
+Export_Put(export_t * ex, const char * data, size_t len)
+{
+	while(len > 0) {
+		export_block_t * block = &ex->blocks[ex->num_blocks];
+		size_t n = BLOCK_SIZE - block->len;
+
+		if(n > len) {
+			n = len;
+		}
+
+		memcpy(block->data + block->len, data, n);
+		block->len += n;
+		data += n;
+		len -= n;
+
+		if(block->len == BLOCK_SIZE && ++ex->num_blocks == ex->max_blocks) {
+			Export_Flush(ex);
+		}
+	}
+}
+
+
+/**************************************************************************
+ * Tar
+ *
+ * Plain ustar: a 512 byte header per file, its data padded out to 512,
+ * and two empty blocks at the end. Everything goes under "documents/",
+ * which is the header's prefix; a name too long for the 100 bytes left
+ * (up to MAX_FILE_CHARS runes of 4 bytes each, plus the extension)
+ * first gets a GNU long name record with the whole path.
+ **************************************************************************/
+
+#define TAR_NAME_LEN 100
+#define TAR_PREFIX_LEN 155
+
+static
+void
+Export_TarRecord(export_t * ex, const char * prefix, const char * name, char type,
+	unsigned long size, time_t mtime)
+{
+	char h[TAR_BLOCK];
+	size_t len = strlen(name);
+	unsigned int sum = 0;
+	int i;
+
+	memset(h, 0, sizeof(h));
+
+	// the fields are full without a NUL at the end
+	memcpy(h, name, len < TAR_NAME_LEN ? len : TAR_NAME_LEN);
+	strncpy(h + 345, prefix, TAR_PREFIX_LEN);
+	sprintf(h + 100, "%07o", type == '5' ? 0755 : 0644);
+	sprintf(h + 108, "%07o", 0);
+	sprintf(h + 116, "%07o", 0);
+	sprintf(h + 124, "%011lo", size);
+	sprintf(h + 136, "%011lo", (unsigned long)mtime);
+	memset(h + 148, ' ', 8);
+	h[156] = type;
+	memcpy(h + 257, "ustar", 6);
+	memcpy(h + 263, "00", 2);
+
+	for(i = 0; i < TAR_BLOCK; ++i) {
+		sum += (unsigned char)h[i];
+	}
+
+	sprintf(h + 148, "%06o", sum);
+
+	Export_Put(ex, h, TAR_BLOCK);
+}
+
+static
+void
+Export_TarHeader(export_t * ex, const char * dir, const char * name, char type,
+	unsigned long size, time_t mtime)
+{
+	static const char zeros[TAR_BLOCK] = {0};
+
+	if(strlen(name) > TAR_NAME_LEN) {
+		size_t len = strlen(dir) + 1 + strlen(name) + 1;
+		char * path = (char *)malloc(len);
+
+		sprintf(path, "%s/%s", dir, name);
+
+		// the name in the header after it is only a fallback
+		Export_TarRecord(ex, "", "././@LongLink", 'L', (unsigned long)len, 0);
+		Export_Put(ex, path, len);
+		if(len % TAR_BLOCK) {
+			Export_Put(ex, zeros, TAR_BLOCK - len % TAR_BLOCK);
+		}
+
+		free(path);
+	}
+
+	Export_TarRecord(ex, dir, name, type, size, mtime);
+}
+
+// 0 if the document couldn't be read (and so isn't in the archive)
+static
+int
+Export_TarFile(export_t * ex, char * name)
+{
+	static const char zeros[TAR_BLOCK] = {0};
+	char * path = Files_GetAbsPath(name);
+	char buf[64 * 1024];
+	FILE * file = fopen(path, "rb");
+	struct stat st;
+	unsigned long left;
+
+	free(path);
+
+	if(!file) {
+		return 0;
+	}
+
+	if(fstat(fileno(file), &st) == -1) {
+		fclose(file);
+		return 0;
+	}
+
+	Export_TarHeader(ex, "documents", name, '0', (unsigned long)st.st_size, st.st_mtime);
+
+	// exactly the size in the header goes in, even if the file changes
+	left = (unsigned long)st.st_size;
+
+	while(left > 0) {
+		size_t n = fread(buf, 1, left < sizeof(buf) ? left : sizeof(buf), file);
+
+		if(n == 0) {
+			memset(buf, 0, sizeof(buf));
+			n = left < sizeof(buf) ? left : sizeof(buf);
+		}
+
+		Export_Put(ex, buf, n);
+		left -= n;
+	}
+
+	fclose(file);
+
+	if(st.st_size % TAR_BLOCK) {
+		Export_Put(ex, zeros, TAR_BLOCK - st.st_size % TAR_BLOCK);
+	}
+
+	return 1;
+}
+
+static
+void
+Export_Main(cs_job_t * job)
+{
+	static const char zeros[2 * TAR_BLOCK] = {0};
+	char part[sizeof(export_path) + 8];
+	export_t ex;
+	int i;
+
+	sprintf(part, "%s.part", export_path);
+
+	ex.out = fopen(part, "wb");
+	ex.ok = (ex.out != 0);
+	ex.num_blocks = 0;
+	ex.max_blocks = BLOCKS_PER_WORKER * Pool_Workers(POOL_MAX_WORKERS);
+	ex.blocks = (export_block_t *)calloc(ex.max_blocks, sizeof(export_block_t));
+
+	for(i = 0; ex.ok && i < ex.max_blocks; ++i) {
+		ex.blocks[i].data = (char *)malloc(BLOCK_SIZE);
+		ex.ok = (ex.blocks[i].data != 0);
+	}
+
+	if(ex.ok) {
+		Export_TarRecord(&ex, "", "documents/", '5', 0, time(NULL));
+	}
+
+	Job_SetTotal(job, export_num);
+
+	for(i = 0; ex.ok && i < export_num; ++i) {
+		if(Job_Cancelled(job)) {
+			ex.ok = 0;
+			break;
+		}
+
+		if(!Export_TarFile(&ex, export_names[i])) {
+			fprintf(stderr, "Could not read %s to export it!\n", export_names[i]);
+			export_failed += 1;
+		}
+		Job_Step(job);
+	}
+
+	if(ex.ok) {
+		Export_Put(&ex, zeros, sizeof(zeros));
+		Export_Flush(&ex);
+	}
+
+	for(i = 0; i < ex.max_blocks; ++i) {
+		free(ex.blocks[i].data);
+	}
+
+	free(ex.blocks);
+
+	if(ex.out) {
+		ex.ok = (fclose(ex.out) == 0) && ex.ok;
+	}
+
+	ex.ok = ex.ok && rename(part, export_path) == 0;
+
+	if(!ex.ok) {
+		remove(part);
+	}
+
+	export_ok = ex.ok;
+}
+
+// once the thread's done; cancelled if it was stopped
+static
+void
+Export_Finish(int cancelled)
+{
+	// a partial archive is kept, but it isn't a backup of everything
+	if(export_ok && export_failed) {
+		fprintf(stderr, "Exported to %s, but without %d document(s) that couldn't be read!\n",
+			export_path, export_failed);
+	} else if(export_ok) {
+		printf("Exported the documents to %s\n", export_path);
+	} else if(!cancelled) {
+		fprintf(stderr, "Could not export to %s!\n", export_path);
+	}
+
+	Files_FreeNames(export_names, export_num);
+	export_names = 0;
+	export_num = 0;
+}
+
+int
+Export_Start()
+{
+	time_t now = time(NULL);
+	char stamp[32];
+
+	if(Job_Running(&export_job)) {
+		return 1;
+	}
+
+	strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", localtime(&now));
+	snprintf(export_path, sizeof(export_path), "%s%s%s%s", EXPORT_DIR, EXPORT_PREFIX, stamp, EXPORT_EXT);
+
+	// the folder's list can change while the export runs (and the open
+	// screen may be showing it, so it isn't rescanned)
+	export_names = Files_CopyNames(&export_num);
+
+	export_ok = 0;
+	export_failed = 0;
+
+	if(!Job_Start(&export_job, Export_Main)) {
+		fputs("Could not start the export thread!\n", stderr);
+
+		Files_FreeNames(export_names, export_num);
+		export_names = 0;
+		export_num = 0;
+
+		return 0;
+	}
+
+	printf("Exporting the documents to %s...\n", export_path);
+
+	return 1;
+}
+
+int
+Export_Progress(int * done, int * total)
+{
+	if(!Job_Running(&export_job)) {
+		return 0;
+	}
+
+	if(Job_Progress(&export_job, done, total)) {
+		return 1;
+	}
+
+	Export_Finish(0);
+
+	return 0;
+}
+
+void
+Export_Cleanup()
+{
+	if(Job_Running(&export_job)) {
+		Job_Stop(&export_job);
+		Export_Finish(1);
+	}
+
+	Job_Destroy(&export_job);
+}
+
+#else
+
+int
+Export_Start()
+{
+	fputs("Exporting needs bzip2, which this build doesn't have.\n", stderr);
+	return 0;
+}
+
+int
+Export_Progress(int * done, int * total)
+{
+	return 0;
+}
+
+void
+Export_Cleanup()
+{
+}
+
+#endif
@@ -0,0 +1,61 @@
+/*************************************************************************
+ * export.h -- Exports the documents folder as a .tar.bz2 archive.
+ *
+ * Candlestick App: Just Write. A minimalist, cross-platform writing app.
+ * Copyright (C) 2013 Thomas Klemz
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************************/
+
+#ifndef CS_EXPORT_H
+#define CS_EXPORT_H
+
+#include "files.h"
+
+// archives go next to the documents folder, named by the time
+#define EXPORT_DIR DOCS_FOLDER "../"
+#define EXPORT_PREFIX "documents-"
+#define EXPORT_EXT ".tar.bz2"
+
+
+/**************************************************************************
+ * Start
+ *
+ * Starts writing every document into a new archive in EXPORT_DIR, in
+ * the background. The tar stream is cut into blocks that are bzip2'd
+ * on every core as independent streams, one after another in the file
+ * (as pbzip2 does; bzip2 and tar read it as usual). Returns 0 if it
+ * couldn't be started (or isn't available, on Windows).
+ **************************************************************************/
+
+int
+Export_Start();
+
+
+/**************************************************************************
+ * Progress
+ *
+ * While an export runs, returns 1 with the number of documents written
+ * so far and how many there are. Once it's done, the first call
+ * finishes up (the archive gets its real name) and returns 0.
+ **************************************************************************/
+
+int
+Export_Progress(int * done, int * total);
+
+// stops an export that's still running (its partial archive is removed)
+void
+Export_Cleanup();
+
+#endif
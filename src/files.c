@@ -4,50 +4,273 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <time.h>
 
 #if defined(__unix__) || defined(__APPLE__)
 #  include <dirent.h>
 #  include <sys/types.h>
 #  include <sys/stat.h>
 #  include <unistd.h>
+#  include <errno.h>
+#  if defined(__linux__)
+#    include <sys/inotify.h>
+#    define FILES_INOTIFY
+#  endif
 #elif defined(_WIN32)
 #  include <windows.h>
 #  include <io.h>
+#  include <sys/types.h>
+#  include <sys/stat.h>
 #endif
 
 #include "natcmp.h"
+#include "doc.h"
+
+
+#define POOL_CHUNK 65536
+
+// bumped whenever the index's names change
+static unsigned long index_version = 0;
+
+// copies the name into the list's string pool
+static
+char *
+Files_PoolStr(files_t * files, char * name, int len)
+{
+	files_chunk_t * chunk = files->pool;
+	char * str;
+
+	if(!chunk || chunk->used + len + 1 > chunk->size) {
+		int size = (len + 1 > POOL_CHUNK) ? len + 1 : POOL_CHUNK;
 
+		chunk = (files_chunk_t*)malloc(sizeof(files_chunk_t) + size);
+		chunk->next = files->pool;
+		chunk->used = 0;
+		chunk->size = size;
+		files->pool = chunk;
+	}
+
+	str = &chunk->data[chunk->used];
+	memcpy(str, name, len + 1);
+	chunk->used += len + 1;
+
+	return str;
+}
 
 static
 void
 Files_Append(files_t * files, char * name)
 {
-	int len = strlen(name);
-	char * filename = malloc(len + 1);
-	strcpy(filename, name);
+	if(files->len == files->cap) {
+		files->cap = files->cap ? files->cap * 2 : 64;
+		files->names = (char**)realloc(files->names, files->cap * sizeof(char*));
+	}
 
-	files->names = (char**)realloc(files->names, (files->len + 1) * sizeof(char*));
-	files->names[files->len] = filename;
+	files->names[files->len] = Files_PoolStr(files, name, strlen(name));
 	files->len += 1;
 }
 
+// finds where name belongs in the sorted list; *found says if it's there
+static
+int
+Files_Find(files_t * files, char * name, int * found)
+{
+	int lo = 0;
+	int hi = files->len;
+	int i;
+	
+	*found = 0;
+	
+	while(lo < hi) {
+		int mid = (lo + hi) / 2;
+		
+		if(natstrcmp(files->names[mid], name) < 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	
+	// names that only differ in case or leading zeros sit together
+	for(i = lo; i < files->len && natstrcmp(files->names[i], name) == 0; ++i) {
+		if(!strcmp(files->names[i], name)) {
+			*found = 1;
+			return i;
+		}
+	}
+	
+	return lo;
+}
+
+static
+void
+Files_InsertSorted(files_t * files, char * name)
+{
+	int found;
+	int pos = Files_Find(files, name, &found);
+	char * added;
+	
+	if(found) {
+		return;
+	}
+	
+	++index_version;
+	Files_Append(files, name);
+	added = files->names[files->len - 1];
+	memmove(&files->names[pos + 1], &files->names[pos], (files->len - 1 - pos) * sizeof(char*));
+	files->names[pos] = added;
+}
+
+static
+void
+Files_RemoveSorted(files_t * files, char * name)
+{
+	int found;
+	int pos = Files_Find(files, name, &found);
+	
+	// the string stays in the pool until the list is destroyed
+	if(found) {
+		++index_version;
+		memmove(&files->names[pos], &files->names[pos + 1], (files->len - 1 - pos) * sizeof(char*));
+		files->len -= 1;
+	}
+}
+
+// name.txt, or name.txt.gz / name.txt.bz2 (see doc.h)
+static
+int
+Files_IsDoc(char * name)
+{
+	int len = strlen(name) - Doc_PackExtLen(name);
+	
+	return len > FILE_EXT_LEN && !strncmp(&name[len - FILE_EXT_LEN], FILE_EXT, FILE_EXT_LEN);
+}
+
 
 /**************************************************************************
- * PopulateFiles
+ * Index
  *
- * This only allows ".txt" extensions at the moment.
- * Creates the list of filenames (just the names, with extensions).
+ * The list of documents is scanned once and kept. It is only scanned
+ * again when the folder's modification time says something changed
+ * behind our back; documents this app writes are inserted in place.
+ * The mtime is read at full resolution where the platform has it, so
+ * only filesystems with coarse timestamps can hide a change made in
+ * the same tick as the scan.
  *
- * Returns the list of files
+ * On Linux the folder is watched with inotify instead: files appearing
+ * and disappearing are applied to the sorted list as they're reported,
+ * and only a lost event (queue overflow, the folder itself going away)
+ * forces a full scan. Checking for changes is then a single
+ * non-blocking read.
  **************************************************************************/
 
-files_t*
-Files_Populate()
+// on Windows, the two halves of the FILETIME
+typedef struct {
+	time_t sec;
+	long nsec;
+} dir_stamp_t;
+
+static files_t * files_index = 0;
+static dir_stamp_t index_stamp = {0, 0};
+
+// modification time of the documents folder, {0, 0} if it can't be read
+static
+dir_stamp_t
+Files_DirStamp()
+{
+	dir_stamp_t stamp = {0, 0};
+#if defined(__unix__) || defined(__APPLE__)
+	struct stat st = {0};
+
+	if(stat(DOCS_FOLDER, &st) != -1) {
+		stamp.sec = st.st_mtime;
+#  if defined(__APPLE__)
+		stamp.nsec = st.st_mtimespec.tv_nsec;
+#  else
+		stamp.nsec = st.st_mtim.tv_nsec;
+#  endif
+	}
+#elif defined(_WIN32)
+	WIN32_FILE_ATTRIBUTE_DATA attr;
+
+	if(GetFileAttributesEx(DOCS_FOLDER, GetFileExInfoStandard, &attr)) {
+		stamp.sec = attr.ftLastWriteTime.dwHighDateTime;
+		stamp.nsec = attr.ftLastWriteTime.dwLowDateTime;
+	}
+#endif
+	return stamp;
+}
+
+/**************************************************************************
+ * Sort
+ *
+ * Sorts naturally, but through precomputed keys (see natkey): every
+ * name is parsed once and the sort itself only does strcmp. Names
+ * that tie (case, leading zeros) are ordered bytewise.
+ **************************************************************************/
+
+typedef struct {
+	char * key;
+	char * name;
+} sort_ent_t;
+
+static
+int
+Files_KeyCmp(const void * p1, const void * p2)
+{
+	const sort_ent_t * e1 = p1;
+	const sort_ent_t * e2 = p2;
+	int cmp = strcmp(e1->key, e2->key);
+	
+	return cmp ? cmp : strcmp(e1->name, e2->name);
+}
+
+static
+void
+Files_Sort(files_t * files)
 {
-	files_t * files = (files_t*)malloc(sizeof(files_t));
-	files->len = 0;
-	files->names = 0;
+	sort_ent_t * ents = (sort_ent_t*)malloc(files->len * sizeof(sort_ent_t));
+	size_t size = 0;
+	char * keys;
+	char * key;
+	int i;
+	
+	for(i = 0; i < files->len; ++i) {
+		size += NATKEY_SIZE(strlen(files->names[i]));
+	}
+	
+	keys = (char*)malloc(size);
+	key = keys;
 	
+	for(i = 0; i < files->len; ++i) {
+		ents[i].key = key;
+		ents[i].name = files->names[i];
+		key += natkey(files->names[i], key) + 1;
+	}
+	
+	qsort(ents, files->len, sizeof(sort_ent_t), Files_KeyCmp);
+	
+	for(i = 0; i < files->len; ++i) {
+		files->names[i] = ents[i].name;
+	}
+	
+	free(keys);
+	free(ents);
+}
+
+
+/**************************************************************************
+ * Scan
+ *
+ * This only allows ".txt" extensions (maybe compressed, see doc.h).
+ * Fills the list with the filenames (just the names, with extensions),
+ * sorted naturally.
+ **************************************************************************/
+
+static
+void
+Files_Scan(files_t * files)
+{
 	Files_CheckDocDir();
 	
 #if defined(__unix__) || defined(__APPLE__)
@@ -57,24 +280,34 @@ Files_Populate()
 		
 		dfd = opendir(DOCS_FOLDER);
 		
-		while((dp = readdir(dfd))) {
-			struct stat st = {0};
-			int len = strlen(dp->d_name);
-			char * filename_full = malloc(len + strlen(DOCS_FOLDER) + 1);
+		while(dfd && (dp = readdir(dfd))) {
+			int regular;
 			
-			sprintf(filename_full, "%s%s", DOCS_FOLDER, dp->d_name);
+			//only do something if the thing is .txt and an actual file
+			if(!Files_IsDoc(dp->d_name)) {
+				continue;
+			}
 			
-			//only do something if the thing is an actual file and is .txt
-			if(stat(filename_full, &st) != -1) {
-				if(S_ISREG(st.st_mode & S_IFMT)) {
-					if(len > 4 && !strcmp(&dp->d_name[len - 4], FILE_EXT)) {
-						Files_Append(files, dp->d_name);
-					}
-				}
+			// the entry's type usually comes with it; only stat (relative
+			// to the open folder, no path building) when the filesystem
+			// doesn't say, or for symlinks
+			if(dp->d_type == DT_REG) {
+				regular = 1;
+			} else if(dp->d_type == DT_UNKNOWN || dp->d_type == DT_LNK) {
+				struct stat st = {0};
+				regular = (fstatat(dirfd(dfd), dp->d_name, &st, 0) != -1 && S_ISREG(st.st_mode));
+			} else {
+				regular = 0;
+			}
+			
+			if(regular) {
+				Files_Append(files, dp->d_name);
 			}
 		}
 		
-		closedir(dfd);
+		if(dfd) {
+			closedir(dfd);
+		}
 	}
 #elif defined(_WIN32)
 	{
@@ -97,12 +330,479 @@ Files_Populate()
 #endif
 
 	if(files->len > 1) {
-		qsort(files->names, files->len, sizeof(files->names[0]), natcmp);
+		Files_Sort(files);
+	}
+}
+
+
+#if defined(FILES_INOTIFY)
+
+static int watch_fd = -1;
+
+#define WATCH_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | \
+	IN_DELETE_SELF | IN_MOVE_SELF)
+
+// 0 if the folder can't be watched (the mtime is used then)
+static
+int
+Files_Watch()
+{
+	watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	
+	if(watch_fd < 0) {
+		return 0;
+	}
+	
+	if(inotify_add_watch(watch_fd, DOCS_FOLDER, WATCH_MASK) < 0) {
+		close(watch_fd);
+		watch_fd = -1;
+		return 0;
+	}
+	
+	return 1;
+}
+
+static
+int
+Files_IsRegular(char * name)
+{
+	struct stat st = {0};
+	char * full = Files_GetAbsPath(name);
+	int regular = (stat(full, &st) != -1 && S_ISREG(st.st_mode));
+	
+	free(full);
+	
+	return regular;
+}
+
+// applies the queued changes to the index; 0 if events were lost
+static
+int
+Files_ReadEvents()
+{
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	ssize_t n;
+	
+	while((n = read(watch_fd, buf, sizeof(buf))) > 0) {
+		char * p = buf;
+		
+		while(p < buf + n) {
+			struct inotify_event * ev = (struct inotify_event *)p;
+			p += sizeof(struct inotify_event) + ev->len;
+			
+			if(ev->mask & (IN_Q_OVERFLOW | IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)) {
+				return 0;
+			}
+			
+			if(ev->len == 0 || (ev->mask & IN_ISDIR) || !Files_IsDoc(ev->name)) {
+				continue;
+			}
+			
+			if(ev->mask & (IN_CREATE | IN_MOVED_TO)) {
+				// it may be gone again by now; its delete is queued then
+				if(Files_IsRegular(ev->name)) {
+					Files_InsertSorted(files_index, ev->name);
+				}
+			} else {
+				Files_RemoveSorted(files_index, ev->name);
+			}
+		}
+	}
+	
+	return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+#endif
+
+// the index still describes what's in the folder
+static
+int
+Files_Current()
+{
+	dir_stamp_t stamp;
+	
+	if(!files_index) {
+		return 0;
+	}
+	
+#if defined(FILES_INOTIFY)
+	if(watch_fd >= 0) {
+		return Files_ReadEvents();
+	}
+#endif
+	
+	stamp = Files_DirStamp();
+	
+	return stamp.sec != 0 &&
+		stamp.sec == index_stamp.sec && stamp.nsec == index_stamp.nsec;
+}
+
+
+/**************************************************************************
+ * Get
+ *
+ * Returns the (cached) list of documents, rescanning the folder only
+ * if it changed. The list belongs to this module; it stays valid until
+ * the next call to Files_Get, Files_Insert or Files_Cleanup.
+ **************************************************************************/
+
+files_t*
+Files_Get()
+{
+	if(files_index && !Files_Current()) {
+		Files_Cleanup();
+	}
+	
+	if(!files_index) {
+		files_index = (files_t*)malloc(sizeof(files_t));
+		files_index->len = 0;
+		files_index->names = 0;
+		files_index->cap = 0;
+		files_index->pool = 0;
+		
+		// watch/stamp first, so a change during the scan isn't missed
+		// (replaying an event the scan already saw does nothing)
+		Files_CheckDocDir();
+#if defined(FILES_INOTIFY)
+		Files_Watch();
+#endif
+		index_stamp = Files_DirStamp();
+		Files_Scan(files_index);
+	}
+	
+	return files_index;
+}
+
+
+/**************************************************************************
+ * BeginWrite / Insert
+ *
+ * Bracket writing a document: BeginWrite notes whether the index is
+ * current before the folder is touched, and Insert then adds the name
+ * (with its extension) in place. If the index was current, it is
+ * again afterwards and the next Files_Get doesn't need to scan.
+ **************************************************************************/
+
+static int index_current_before_write = 0;
+
+void
+Files_BeginWrite()
+{
+	index_current_before_write = Files_Current();
+}
+
+void
+Files_Insert(char * name)
+{
+	if(!files_index) {
+		return;
+	}
+	
+	if(!index_current_before_write) {
+		// something else changed too; let Files_Get rescan
+		Files_Cleanup();
+		return;
+	}
+	
+	index_current_before_write = 0;
+	
+	// with a watch, the event for this comes later and is a no-op
+	Files_InsertSorted(files_index, name);
+	index_stamp = Files_DirStamp();
+}
+
+
+/**************************************************************************
+ * BeginSideWrite / EndSideWrite
+ *
+ * Bracket writing a file in the folder that isn't a document (like the
+ * metadata): nothing listed changes, so if the folder's mtime was the
+ * index's before, it's made so again after. Only the mtime is looked
+ * at, never the list, as the open screen may be showing it (a watch
+ * skips the events for such files anyway).
+ **************************************************************************/
+
+static int index_stamped_before_side_write = 0;
+
+void
+Files_BeginSideWrite()
+{
+	dir_stamp_t stamp = Files_DirStamp();
+	
+	index_stamped_before_side_write = files_index && stamp.sec != 0 &&
+		stamp.sec == index_stamp.sec && stamp.nsec == index_stamp.nsec;
+}
+
+void
+Files_EndSideWrite()
+{
+	if(files_index && index_stamped_before_side_write) {
+		index_stamp = Files_DirStamp();
+	}
+	
+	index_stamped_before_side_write = 0;
+}
+
+
+
+/**************************************************************************
+ * CopyNames
+ *
+ * Copies the names in the list as Files_Get last returned it, for work
+ * done in the background. The folder isn't looked at again: the open
+ * screen may be showing that list (or a filter of it), which a rescan
+ * would free. Only scans if there's no list yet.
+ **************************************************************************/
+
+char **
+Files_CopyNames(int * num)
+{
+	files_t * files = files_index ? files_index : Files_Get();
+	char ** names = (char **)malloc((files->len + 1) * sizeof(char *));
+	int i;
+
+	for(i = 0; i < files->len; ++i) {
+		names[i] = (char *)malloc(strlen(files->names[i]) + 1);
+		strcpy(names[i], files->names[i]);
+	}
+
+	*num = files->len;
+
+	return names;
+}
+
+void
+Files_FreeNames(char ** names, int num)
+{
+	int i;
+
+	for(i = 0; i < num; ++i) {
+		free(names[i]);
+	}
+
+	free(names);
+}
+
+static
+void
+Files_ClearFilter();
+
+void
+Files_Cleanup()
+{
+	++index_version;
+	Files_ClearFilter();
+	
+	if(files_index) {
+		Files_Destroy(files_index);
+		free(files_index);
+		files_index = 0;
 	}
 	
-	return files;
+#if defined(FILES_INOTIFY)
+	if(watch_fd >= 0) {
+		close(watch_fd);
+		watch_fd = -1;
+	}
+#endif
 }
 
+/**************************************************************************
+ * Filter
+ *
+ * Type-to-filter for the open screen: keeps the names that contain the
+ * query, ignoring ASCII case. Typing only ever extends or shortens the
+ * query by a character, so the matches for every prefix of the query
+ * are kept as levels: extending it only looks at the previous level's
+ * matches, and shortening it just drops a level. Each match remembers
+ * where the query first occurs in the name; the longer query usually
+ * occurs right there (it's the old one plus the next character), so
+ * most names are decided with a single compare. Only the first
+ * character searches every name, in a lowercased copy of them all laid
+ * out in one buffer.
+ **************************************************************************/
+
+typedef struct {
+	int * idx;  // name
+	int * pos;  // first occurrence of the query in it
+	int len;
+	int cap;
+} filter_level_t;
+
+static char * fold_buf = 0;          // all names lowercased, '\0' separated
+static int * fold_off = 0;           // where each name starts in fold_buf
+static unsigned long fold_version = 0;
+
+static filter_level_t * levels = 0;  // levels[l]: matches for query[0..l]
+static int num_levels = 0;
+static int levels_size = 0;
+static char * filter_query = 0;      // lowercased query the levels are for
+static files_t filter_view = {0};
+
+static
+void
+Files_ClearFilter()
+{
+	int i;
+	
+	for(i = 0; i < levels_size; ++i) {
+		free(levels[i].idx);
+		free(levels[i].pos);
+	}
+	free(levels);
+	free(fold_buf);
+	free(fold_off);
+	free(filter_query);
+	free(filter_view.names);
+	
+	levels = 0;
+	num_levels = 0;
+	levels_size = 0;
+	fold_buf = 0;
+	fold_off = 0;
+	filter_query = 0;
+	filter_view.names = 0;
+	filter_view.len = 0;
+	filter_view.cap = 0;
+}
+
+static
+void
+Files_Fold(files_t * files)
+{
+	size_t size = 0;
+	int i;
+	
+	Files_ClearFilter();
+	
+	for(i = 0; i < files->len; ++i) {
+		size += strlen(files->names[i]) + 1;
+	}
+	
+	fold_buf = (char*)malloc(size + 1);
+	fold_off = (int*)malloc((files->len + 1) * sizeof(int));
+	size = 0;
+	
+	for(i = 0; i < files->len; ++i) {
+		char * c = files->names[i];
+		
+		fold_off[i] = size;
+		
+		while(*c) {
+			fold_buf[size++] = tolower((unsigned char)*c++);
+		}
+		fold_buf[size++] = '\0';
+	}
+	
+	fold_version = index_version;
+}
+
+
+/**************************************************************************
+ * Filter
+ *
+ * Returns the documents whose names contain query (case-insensitive),
+ * in the same order as Files_Get. An empty query gives the whole list.
+ * The result belongs to this module, like the one from Files_Get.
+ **************************************************************************/
+
+files_t*
+Files_Filter(char * query)
+{
+	files_t * all = Files_Get();
+	int qlen = strlen(query);
+	int keep = 0;
+	int l;
+	int i;
+	
+	if(qlen == 0) {
+		return all;
+	}
+	
+	if(!fold_buf || fold_version != index_version) {
+		Files_Fold(all);
+	}
+	
+	// the levels for what the query still shares with the last one stay
+	while(keep < num_levels && keep < qlen &&
+		tolower((unsigned char)query[keep]) == filter_query[keep]) {
+		++keep;
+	}
+	
+	num_levels = keep;
+	filter_query = (char*)realloc(filter_query, qlen + 1);
+	
+	for(i = 0; i <= qlen; ++i) {
+		filter_query[i] = tolower((unsigned char)query[i]);
+	}
+	
+	if(levels_size < qlen) {
+		levels = (filter_level_t*)realloc(levels, qlen * sizeof(filter_level_t));
+		memset(&levels[levels_size], 0, (qlen - levels_size) * sizeof(filter_level_t));
+		levels_size = qlen;
+	}
+	
+	for(l = num_levels; l < qlen; ++l) {
+		filter_level_t * cur = &levels[l];
+		filter_level_t * prev = (l > 0) ? &levels[l - 1] : 0;
+		int prev_len = prev ? prev->len : all->len;
+		char c = filter_query[l + 1];
+		
+		if(cur->cap < prev_len) {
+			cur->cap = prev_len;
+			cur->idx = (int*)realloc(cur->idx, cur->cap * sizeof(int));
+			cur->pos = (int*)realloc(cur->pos, cur->cap * sizeof(int));
+		}
+		
+		// search for the first l + 1 characters
+		filter_query[l + 1] = '\0';
+		cur->len = 0;
+		
+		for(i = 0; i < prev_len; ++i) {
+			char * name;
+			char * at;
+			
+			if(!prev) {
+				name = &fold_buf[fold_off[i]];
+				at = strchr(name, filter_query[0]);
+			} else {
+				name = &fold_buf[fold_off[prev->idx[i]]];
+				at = &name[prev->pos[i]];
+				
+				// an earlier hit would have been an earlier hit of the
+				// shorter query too
+				if(at[l] != filter_query[l]) {
+					at = strstr(at + 1, filter_query);
+				}
+			}
+			
+			if(at) {
+				cur->idx[cur->len] = prev ? prev->idx[i] : i;
+				cur->pos[cur->len] = at - name;
+				++cur->len;
+			}
+		}
+		
+		filter_query[l + 1] = c;
+	}
+	
+	num_levels = qlen;
+	
+	if(filter_view.cap < levels[qlen - 1].len) {
+		filter_view.cap = levels[qlen - 1].len;
+		filter_view.names = (char**)realloc(filter_view.names, filter_view.cap * sizeof(char*));
+	}
+	
+	filter_view.len = levels[qlen - 1].len;
+	
+	for(i = 0; i < filter_view.len; ++i) {
+		filter_view.names[i] = all->names[levels[qlen - 1].idx[i]];
+	}
+	
+	return &filter_view;
+}
+
+
 // Doctor checkup. Ha ha.
 void
 Files_CheckDocDir()
@@ -136,6 +836,38 @@ Files_Exists(char * filename)
     return 0;
 }
 
+int
+Files_Stat(char * name, unsigned long long * mtime, unsigned long long * size)
+{
+	char * full = Files_GetAbsPath(name);
+	int ok;
+#if defined(__unix__) || defined(__APPLE__)
+	struct stat st;
+	ok = (stat(full, &st) != -1);
+
+	if(ok) {
+#  if defined(__APPLE__)
+		*mtime = st.st_mtimespec.tv_sec * 1000000000ULL + st.st_mtimespec.tv_nsec;
+#  else
+		*mtime = st.st_mtim.tv_sec * 1000000000ULL + st.st_mtim.tv_nsec;
+#  endif
+		*size = (unsigned long long)st.st_size;
+	}
+#elif defined(_WIN32)
+	struct _stat st;
+	ok = (_stat(full, &st) != -1);
+
+	if(ok) {
+		*mtime = (unsigned long long)st.st_mtime;
+		*size = (unsigned long long)st.st_size;
+	}
+#endif
+
+	free(full);
+
+	return ok;
+}
+
 
 /**************************************************************************
  * GetAbsPath
@@ -167,14 +899,16 @@ void
 Files_Destroy(files_t * files)
 {
 	if(files) {
-		int i;
-		for(i = 0; i < files->len; ++i) {
-			free(files->names[i]);
+		while(files->pool) {
+			files_chunk_t * next = files->pool->next;
+			free(files->pool);
+			files->pool = next;
 		}
 		free(files->names);
 
 		files->names = 0;
 		files->len = 0;
+		files->cap = 0;
 	}
 
 	files = 0;
@@ -13,14 +13,50 @@
 #define MAX_FILE_CHARS (CHARS_PER_LINE - FILE_EXT_LEN)
 
 
+// names live in a list of these, a few thousand per chunk
+typedef struct files_chunk_tag {
+	struct files_chunk_tag * next;
+	int used;
+	int size;
+	char data[1];
+} files_chunk_t;
+
 typedef struct files_tag {
 	char ** names;
 	int len;
+	int cap;
+	files_chunk_t * pool;
 } files_t;
 
 
 files_t*
-Files_Populate();
+Files_Get();
+
+void
+Files_BeginWrite();
+
+void
+Files_Insert(char * name);
+
+// around writing a file in the folder that isn't a document
+void
+Files_BeginSideWrite();
+
+void
+Files_EndSideWrite();
+
+void
+Files_Cleanup();
+
+// a copy of the names as they were last listed, without rescanning
+char **
+Files_CopyNames(int * num);
+
+void
+Files_FreeNames(char ** names, int num);
+
+files_t*
+Files_Filter(char * query);
 
 void
 Files_CheckDocDir();
@@ -28,6 +64,11 @@ Files_CheckDocDir();
 int
 Files_Exists(char * filename);
 
+// mtime (in ns where there's more than seconds) and size of a
+// document (name with extension); 0 if it can't be read
+int
+Files_Stat(char * name, unsigned long long * mtime, unsigned long long * size);
+
 char *
 Files_GetAbsPath(char * filename);
 
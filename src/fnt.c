@@ -47,6 +47,7 @@
 #include "opengl.h"
 #include "utf.h"
 #include "utils.h"
+#include "glproc.h"
 
 #include <ft2build.h>
 #include FT_FREETYPE_H
@@ -59,6 +60,10 @@
 #define XPRECISION 4
 #define YPRECISION 1
 
+#define SDF_SIZE 48		/* em size (pixels) the distance fields are rendered at */
+#define SDF_SPREAD 6	/* pixels of distance encoded on each side of an edge */
+#define SDF_CACHESIZE 1024
+
 static inline void die(char *msg)
 {
 	fprintf(stderr, "error: %s\n", msg);
@@ -71,6 +76,9 @@ struct fnt_t
 	float size;
 	FT_Face face;
 	float line_height;
+	int fixed; //every glyph advances by w (monospace)
+	float ascent; //tallest glyph above the baseline (pixels)
+	float descent; //deepest glyph below the baseline (pixels)
 };
 
 struct key
@@ -105,6 +113,81 @@ static int g_cache_row_y = 0;
 static int g_cache_row_x = 0;
 static int g_cache_row_h = 0;
 
+/*
+ * The distance field cache is keyed by glyph only (no size, no subpixel
+ * offset), so one entry serves every size the face is drawn at.
+ */
+static int g_sdf = 0;
+static GLuint g_sdf_prog = 0;
+static struct table g_sdf_table[MAXGLYPHS];
+static int g_sdf_table_load = 0;
+static unsigned int g_sdf_tex = 0;
+static int g_sdf_row_y = 0;
+static int g_sdf_row_x = 0;
+static int g_sdf_row_h = 0;
+
+static const char * const g_sdf_vert =
+	"void main()\n"
+	"{\n"
+	"	gl_TexCoord[0] = gl_MultiTexCoord0;\n"
+	"	gl_FrontColor = gl_Color;\n"
+	"	gl_Position = ftransform();\n"
+	"}\n";
+
+static const char * const g_sdf_frag =
+	"uniform sampler2D atlas;\n"
+	"void main()\n"
+	"{\n"
+	"	float d = texture2D(atlas, gl_TexCoord[0].st).a;\n"
+	"	float w = clamp(fwidth(d) * 0.75, 0.001, 0.5);\n"
+	"	float a = smoothstep(0.5 - w, 0.5 + w, d);\n"
+	"	gl_FragColor = vec4(gl_Color.rgb, gl_Color.a * a);\n"
+	"}\n";
+
+static void clear_sdf_cache(void);
+
+static void init_sdf_cache(void)
+{
+	unsigned char *zero;
+
+	GLProc_Init();
+
+	g_sdf_prog = GLProc_Program(g_sdf_vert, g_sdf_frag);
+	g_sdf = (g_sdf_prog != 0);
+
+	if (!g_sdf)
+		return;
+
+	cs_glUseProgram(g_sdf_prog);
+	cs_glUniform1i(cs_glGetUniformLocation(g_sdf_prog, "atlas"), 0);
+	cs_glUseProgram(0);
+
+	/* linear filtering reads the gaps between glyphs, so start clean */
+	zero = calloc(SDF_CACHESIZE * SDF_CACHESIZE, 1);
+
+	glGenTextures(1, &g_sdf_tex);
+	glBindTexture(GL_TEXTURE_2D, g_sdf_tex);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, SDF_CACHESIZE, SDF_CACHESIZE, 0, GL_ALPHA, GL_UNSIGNED_BYTE, zero);
+
+	free(zero);
+
+	clear_sdf_cache();
+}
+
+static void clear_sdf_cache(void)
+{
+	memset(g_sdf_table, 0, sizeof(g_sdf_table));
+	g_sdf_table_load = 0;
+
+	g_sdf_row_y = 1;
+	g_sdf_row_x = 1;
+	g_sdf_row_h = 0;
+}
+
 static void init_font_cache(void)
 {
 	int code;
@@ -120,6 +203,8 @@ static void init_font_cache(void)
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, g_cache_w, g_cache_h, 0, GL_ALPHA, GL_UNSIGNED_BYTE, NULL);
+
+	init_sdf_cache();
 }
 
 static void clear_font_cache(void)
@@ -167,6 +252,15 @@ static void free_font(FT_Face face)
 	FT_Done_FreeType(g_freetype_lib);
 	g_freetype_lib = NULL;
 	glDeleteTextures(1, &g_cache_tex);
+
+	if (g_sdf)
+	{
+		clear_sdf_cache();
+		glDeleteTextures(1, &g_sdf_tex);
+		cs_glDeleteProgram(g_sdf_prog);
+		g_sdf_prog = 0;
+		g_sdf = 0;
+	}
 }
 
 static unsigned int hashfunc(struct key *key)
@@ -179,14 +273,14 @@ static unsigned int hashfunc(struct key *key)
 	return h;
 }
 
-static unsigned int lookup_table(struct key *key)
+static unsigned int lookup_table(struct table *table, struct key *key)
 {
 	unsigned int pos = hashfunc(key) % MAXGLYPHS;
 	while (1)
 	{
-		if (!g_table[pos].key.face) /* empty slot */
+		if (!table[pos].key.face) /* empty slot */
 			return pos;
-		if (!memcmp(key, &g_table[pos].key, sizeof(struct key))) /* matching slot */
+		if (!memcmp(key, &table[pos].key, sizeof(struct key))) /* matching slot */
 			return pos;
 		pos = (pos + 1) % MAXGLYPHS;
 	}
@@ -210,7 +304,7 @@ static struct glyph * lookup_glyph(FT_Face face, int size, int gid, int subx, in
 	key.subx = subx;
 	key.suby = suby;
 
-	pos = lookup_table(&key);
+	pos = lookup_table(g_table, &key);
 	if (g_table[pos].key.face)
 		return &g_table[pos].glyph;
 
@@ -244,7 +338,7 @@ static struct glyph * lookup_glyph(FT_Face face, int size, int gid, int subx, in
 	{
 		puts("font cache table full, clearing cache");
 		clear_font_cache();
-		pos = lookup_table(&key);
+		pos = lookup_table(g_table, &key);
 	}
 
 	if (h + PADDING > g_cache_h || w + PADDING > g_cache_w)
@@ -259,7 +353,7 @@ static struct glyph * lookup_glyph(FT_Face face, int size, int gid, int subx, in
 	{
 		puts("font cache texture full, clearing cache");
 		clear_font_cache();
-		pos = lookup_table(&key);
+		pos = lookup_table(g_table, &key);
 	}
 
 	/*
@@ -291,9 +385,258 @@ static struct glyph * lookup_glyph(FT_Face face, int size, int gid, int subx, in
 	return &g_table[pos].glyph;
 }
 
+/*
+ * Distance transform (8SSEDT). Each cell holds the offset to the
+ * nearest seed cell; two sweeps propagate the offsets across the grid.
+ * The grid has a one cell border that is never a seed, so the sweeps
+ * need no bounds checks.
+ */
+
+struct sdf_pt
+{
+	int dx, dy;
+};
+
+#define SDF_FAR 9999
+
+static inline int sdf_dist2(struct sdf_pt p)
+{
+	return p.dx * p.dx + p.dy * p.dy;
+}
+
+static inline void sdf_compare(struct sdf_pt *g, int gw, int x, int y, int ox, int oy)
+{
+	struct sdf_pt p = g[(y + oy) * gw + x + ox];
+	p.dx += ox;
+	p.dy += oy;
+	if (sdf_dist2(p) < sdf_dist2(g[y * gw + x]))
+		g[y * gw + x] = p;
+}
+
+static void sdf_sweep(struct sdf_pt *g, int gw, int gh)
+{
+	int x, y;
+
+	for (y = 1; y < gh - 1; y++)
+	{
+		for (x = 1; x < gw - 1; x++)
+		{
+			sdf_compare(g, gw, x, y, -1, 0);
+			sdf_compare(g, gw, x, y, 0, -1);
+			sdf_compare(g, gw, x, y, -1, -1);
+			sdf_compare(g, gw, x, y, 1, -1);
+		}
+		for (x = gw - 2; x > 0; x--)
+			sdf_compare(g, gw, x, y, 1, 0);
+	}
+
+	for (y = gh - 2; y > 0; y--)
+	{
+		for (x = gw - 2; x > 0; x--)
+		{
+			sdf_compare(g, gw, x, y, 1, 0);
+			sdf_compare(g, gw, x, y, 0, 1);
+			sdf_compare(g, gw, x, y, -1, 1);
+			sdf_compare(g, gw, x, y, 1, 1);
+		}
+		for (x = 1; x < gw - 1; x++)
+			sdf_compare(g, gw, x, y, -1, 0);
+	}
+}
+
+/*
+ * Turns a coverage bitmap (sw x sh) into a distance field (dw x dh)
+ * with SDF_SPREAD pixels of margin. 128 is the edge; larger is inside.
+ */
+static void make_sdf(unsigned char *src, int sw, int sh, int pitch, unsigned char *dst, int dw, int dh)
+{
+	int gw = dw + 2;
+	int gh = dh + 2;
+	struct sdf_pt *in = malloc(gw * gh * sizeof(struct sdf_pt));
+	struct sdf_pt *out = malloc(gw * gh * sizeof(struct sdf_pt));
+	struct sdf_pt far = { SDF_FAR, SDF_FAR };
+	struct sdf_pt zero = { 0, 0 };
+	int x, y;
+
+	for (y = 0; y < gh; y++)
+	{
+		for (x = 0; x < gw; x++)
+		{
+			int sx = x - 1 - SDF_SPREAD;
+			int sy = y - 1 - SDF_SPREAD;
+			int inside = 0;
+
+			if (x > 0 && y > 0 && x < gw - 1 && y < gh - 1 &&
+				sx >= 0 && sy >= 0 && sx < sw && sy < sh)
+				inside = src[sy * pitch + sx] >= 128;
+
+			/* "in" seeds the inside and measures the outside, and vice versa */
+			in[y * gw + x] = inside ? zero : far;
+			out[y * gw + x] = inside ? far : zero;
+		}
+	}
+
+	/* the border must never act as a seed */
+	for (x = 0; x < gw; x++)
+		out[x] = out[(gh - 1) * gw + x] = far;
+	for (y = 0; y < gh; y++)
+		out[y * gw] = out[y * gw + gw - 1] = far;
+
+	sdf_sweep(in, gw, gh);
+	sdf_sweep(out, gw, gh);
+
+	for (y = 0; y < dh; y++)
+	{
+		for (x = 0; x < dw; x++)
+		{
+			int i = (y + 1) * gw + x + 1;
+			float d = sqrtf(sdf_dist2(out[i])) - sqrtf(sdf_dist2(in[i]));
+			float v = 128.0f + d * (127.0f / SDF_SPREAD);
+			dst[y * dw + x] = v < 0.0f ? 0 : (v > 255.0f ? 255 : (unsigned char)v);
+		}
+	}
+
+	free(in);
+	free(out);
+}
+
+static struct glyph * lookup_sdf_glyph(FT_Face face, int size, int gid)
+{
+	struct key key;
+	unsigned int pos;
+	unsigned char *field;
+	int code;
+	int w, h;
+
+	memset(&key, 0, sizeof(key));
+	key.face = face;
+	key.gid = gid;
+
+	pos = lookup_table(g_sdf_table, &key);
+	if (g_sdf_table[pos].key.face)
+		return &g_sdf_table[pos].glyph;
+
+	/*
+	 * Render the bitmap once, at the reference size
+	 */
+
+	glEnd();
+
+	FT_Set_Char_Size(face, SDF_SIZE * 64, SDF_SIZE * 64, 72, 72);
+	FT_Set_Transform(face, NULL, NULL);
+
+	code = FT_Load_Glyph(face, gid, FT_LOAD_NO_BITMAP | FT_LOAD_NO_HINTING);
+	if (code == 0)
+		code = FT_Render_Glyph(face->glyph, FT_RENDER_MODE_NORMAL);
+
+	if (code)
+	{
+		FT_Set_Char_Size(face, size, size, 72, 72);
+		glBegin(GL_QUADS);
+		return NULL;
+	}
+
+	w = face->glyph->bitmap.width;
+	h = face->glyph->bitmap.rows;
+
+	/* blank glyphs (spaces) only need an advance */
+	if (w > 0 && h > 0)
+	{
+		w += 2 * SDF_SPREAD;
+		h += 2 * SDF_SPREAD;
+	}
+
+	/*
+	 * Find an empty slot in the texture
+	 */
+
+	if (g_sdf_table_load == (MAXGLYPHS * 3) / 4)
+	{
+		puts("sdf cache table full, clearing cache");
+		clear_sdf_cache();
+		pos = lookup_table(g_sdf_table, &key);
+	}
+
+	if (g_sdf_row_x + w + 1 > SDF_CACHESIZE)
+	{
+		g_sdf_row_y += g_sdf_row_h + 1;
+		g_sdf_row_x = 1;
+	}
+	if (g_sdf_row_y + h + 1 > SDF_CACHESIZE)
+	{
+		puts("sdf cache texture full, clearing cache");
+		clear_sdf_cache();
+		pos = lookup_table(g_sdf_table, &key);
+	}
+
+	memcpy(&g_sdf_table[pos].key, &key, sizeof(struct key));
+	g_sdf_table[pos].glyph.w = w;
+	g_sdf_table[pos].glyph.h = h;
+	g_sdf_table[pos].glyph.lsb = face->glyph->bitmap_left - SDF_SPREAD;
+	g_sdf_table[pos].glyph.top = face->glyph->bitmap_top + SDF_SPREAD;
+	g_sdf_table[pos].glyph.s = g_sdf_row_x;
+	g_sdf_table[pos].glyph.t = g_sdf_row_y;
+	g_sdf_table[pos].glyph.advance = face->glyph->advance.x / 64.0;
+	g_sdf_table_load ++;
+
+	if (w > 0 && h > 0)
+	{
+		field = malloc(w * h);
+		make_sdf(face->glyph->bitmap.buffer, face->glyph->bitmap.width,
+				face->glyph->bitmap.rows, face->glyph->bitmap.pitch, field, w, h);
+
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, g_sdf_row_x, g_sdf_row_y, w, h,
+				GL_ALPHA, GL_UNSIGNED_BYTE, field);
+
+		free(field);
+
+		g_sdf_row_x += w + 1;
+		if (g_sdf_row_h < h)
+			g_sdf_row_h = h;
+	}
+
+	/* the caller still measures kerning at its own size */
+	FT_Set_Char_Size(face, size, size, 72, 72);
+
+	glBegin(GL_QUADS);
+
+	return &g_sdf_table[pos].glyph;
+}
+
+static float draw_glyph_sdf(FT_Face face, int size, int gid, float x, float y)
+{
+	struct glyph *glyph;
+	float scale = size / (64.0f * SDF_SIZE);
+
+	glyph = lookup_sdf_glyph(face, size, gid);
+	if (!glyph)
+		return 0.0;
+
+	float s0 = (float) glyph->s / SDF_CACHESIZE;
+	float t0 = (float) glyph->t / SDF_CACHESIZE;
+	float s1 = (float) (glyph->s + glyph->w) / SDF_CACHESIZE;
+	float t1 = (float) (glyph->t + glyph->h) / SDF_CACHESIZE;
+	float x0 = x + glyph->lsb * scale;
+	float y0 = y - glyph->top * scale;
+	float x1 = x0 + glyph->w * scale;
+	float y1 = y0 + glyph->h * scale;
+
+	glTexCoord2f(s0, t0); glVertex2f(x0, y0);
+	glTexCoord2f(s1, t0); glVertex2f(x1, y0);
+	glTexCoord2f(s1, t1); glVertex2f(x1, y1);
+	glTexCoord2f(s0, t1); glVertex2f(x0, y1);
+
+	return glyph->advance * scale;
+}
+
 static float draw_glyph(FT_Face face, int size, int gid, float x, float y)
 {
 	struct glyph *glyph;
+
+	if (g_sdf)
+		return draw_glyph_sdf(face, size, gid, x, y);
+
 	int subx = (x - floor(x)) * XPRECISION;
 	int suby = (y - floor(y)) * YPRECISION;
 	subx = (subx * 64) / XPRECISION;
@@ -352,7 +695,7 @@ static float draw_string(FT_Face face, float fsize, float x, float y, char *str)
 
 	FT_Set_Char_Size(face, size, size, 72, 72);
 
-	glBindTexture(GL_TEXTURE_2D, g_cache_tex);
+	glBindTexture(GL_TEXTURE_2D, g_sdf ? g_sdf_tex : g_cache_tex);
 	glBegin(GL_QUADS);
 
 	while(*str)
@@ -370,6 +713,62 @@ static float draw_string(FT_Face face, float fsize, float x, float y, char *str)
 	return x;
 }
 
+/*
+ * Monospace fast path. Every glyph sits at column * advance, so there
+ * is no advance accumulation and no kerning lookup. The line is decoded
+ * into glyph ids first, then all of the pen positions are computed in
+ * one tight loop (which the compiler is free to vectorize), and only
+ * then are the quads emitted.
+ */
+
+#define FIXED_BATCH 128
+
+static float draw_string_fixed(FT_Face face, float fsize, float advance, float x, float y, char *str)
+{
+	int size = fsize * 64;
+	Rune ucs;
+	Rune gids[FIXED_BATCH];
+	float xs[FIXED_BATCH];
+	int col = 0;
+	int n, i;
+
+	FT_Set_Char_Size(face, size, size, 72, 72);
+
+	glBindTexture(GL_TEXTURE_2D, g_sdf ? g_sdf_tex : g_cache_tex);
+	glBegin(GL_QUADS);
+
+	while(*str)
+	{
+		for(n = 0; n < FIXED_BATCH && *str; ++n) {
+			str += chartorune(&ucs, str);
+			gids[n] = FT_Get_Char_Index(face, ucs);
+		}
+
+		for(i = 0; i < n; ++i) {
+			xs[i] = x + (col + i) * advance;
+		}
+
+		for(i = 0; i < n; ++i) {
+			draw_glyph(face, size, gids[i], xs[i], y);
+		}
+
+		col += n;
+	}
+
+	glEnd();
+
+	return x + col * advance;
+}
+
+static float draw_text(Fnt * fnt, float x, float y, char *str)
+{
+	if(fnt->fixed) {
+		return draw_string_fixed(fnt->face, fnt->size, fnt->w, x, y, str);
+	}
+
+	return draw_string(fnt->face, fnt->size, x, y, str);
+}
+
 /**********************************************************************
  * return the font character width
  **********************************************************************/
@@ -377,6 +776,9 @@ static
 void
 Fnt_CalcWidth(Fnt * fnt)
 {
+	//a few glyphs that differ wildly in a proportional face
+	static const char * const probe = "iMW.l ";
+	const char * p;
 	int size = fnt->size * 64;
 	FT_Fixed advance;
 	FT_Vector kern;
@@ -391,6 +793,24 @@ Fnt_CalcWidth(Fnt * fnt)
 	w += kern.x / 64.0;
 
 	fnt->w = w;
+
+	fnt->ascent = fnt->face->bbox.yMax * fnt->size / fnt->face->units_per_EM;
+	fnt->descent = -fnt->face->bbox.yMin * fnt->size / fnt->face->units_per_EM;
+
+	/*
+	 * Not every monospace face sets the fixed pitch flag
+	 * (Lekton doesn't), so also compare the advances directly.
+	 */
+	fnt->fixed = !FT_HAS_KERNING(fnt->face);
+
+	if(fnt->fixed && !FT_IS_FIXED_WIDTH(fnt->face)) {
+		for(p = probe; *p && fnt->fixed; ++p) {
+			FT_Fixed adv;
+			gid = FT_Get_Char_Index(fnt->face, *p);
+			FT_Get_Advance(fnt->face, gid, FT_LOAD_NO_BITMAP | FT_LOAD_NO_HINTING, &adv);
+			fnt->fixed = (adv == advance);
+		}
+	}
 }
 
 float
@@ -408,9 +828,20 @@ Fnt_Size(Fnt * fnt)
 	return fnt->size;
 }
 
+/**********************************************************************
+ * sets the size in pixels (e.g. when the display scale changes)
+ *
+ * Bitmap glyphs are keyed by pixel size, so entries for the old size
+ * would only sit in the texture until it fills up; drop them now.
+ * Distance field glyphs are size independent and stay.
+ **********************************************************************/
 void
 Fnt_SetSize(Fnt * fnt, float size)
 {
+	if(size != fnt->size && !g_sdf) {
+		clear_font_cache();
+	}
+
 	fnt->size = size;
 	Fnt_CalcWidth(fnt);
 }
@@ -424,6 +855,21 @@ Fnt_LineHeight(Fnt * fnt)
 	return fnt->line_height;
 }
 
+/**********************************************************************
+ * returns how far any glyph reaches above/below the baseline
+ **********************************************************************/
+float
+Fnt_Ascent(Fnt * fnt)
+{
+	return fnt->ascent;
+}
+
+float
+Fnt_Descent(Fnt * fnt)
+{
+	return fnt->descent;
+}
+
 /**********************************************************************
  * creates a fnt with a given name and height (in points)
  **********************************************************************/
@@ -453,7 +899,8 @@ Fnt_Destroy(Fnt * fnt)
 }
 
 /**********************************************************************
- * prints text at window coords (x,y) using the fnt
+ * prints text at window coords (x,y) using the fnt; expects the
+ * frame's screen pass (see BeginScreenPass) to be set up
  **********************************************************************/
 
 inline
@@ -461,106 +908,91 @@ static
 int
 Fnt_PrintCursor(Fnt * fnt, int x, int y)
 {
-	glPushMatrix();
-		
 	glBegin(GL_LINES);
 		glVertex2f(x, (float)y);
 		glVertex2f(x + fnt->w, (float)y);
 	glEnd();
 	
-	glPopMatrix();
-	
 	return x + fnt->w;
 }
 
 float
 Fnt_Print(Fnt * fnt, char * str, int x, int y, int show_cursor)
 {
-	float modelview_matrix[16];
 	float amt;
 	
-	PushScreenCoordMat();
-	
-	glPushAttrib(GL_LIST_BIT | GL_CURRENT_BIT  | GL_ENABLE_BIT | GL_TRANSFORM_BIT);
-	
-	glMatrixMode(GL_MODELVIEW);
-	glDisable(GL_LIGHTING);
 	glEnable(GL_TEXTURE_2D);
-	glDisable(GL_DEPTH_TEST);
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	
-	glGetFloatv(GL_MODELVIEW_MATRIX, modelview_matrix);
-	
-	glPushMatrix();
-	
-	amt = draw_string(fnt->face, fnt->size, (float)x, (float)y, str);
-	
-	glPopMatrix();
-	glPopAttrib();
+	amt = Fnt_DrawText(fnt, str, (float)x, (float)y);
+	glDisable(GL_TEXTURE_2D);
 	
 	if(show_cursor) {
 		amt = Fnt_PrintCursor(fnt, amt, y);
 	}
 	
-	PopScreenCoordMat();
-	
+	return amt;
+}
+
+/**********************************************************************
+ * draws text with whatever GL state the caller has set up (blending,
+ * projection); only the glyph texture and program are handled here
+ **********************************************************************/
+
+float
+Fnt_DrawText(Fnt * fnt, char * str, float x, float y)
+{
+	float amt;
+
+	if(g_sdf) {
+		cs_glUseProgram(g_sdf_prog);
+	}
+
+	amt = draw_text(fnt, x, y, str);
+
+	if(g_sdf) {
+		cs_glUseProgram(0);
+	}
+
 	return amt;
 }
 
 float
 Fnt_PrintFrame(Fnt * fnt, Frame * frm, int x, int y, int max_lines, int show_cursor)
 {
-	float modelview_matrix[16];
-	
 	Line * cur_line;
 	int line = 0;
 	float cursor_x = 0;
 	float h = fnt->line_height * 1.55 * fnt->w;
-	FT_Face f = fnt->face;
-	float s = fnt->size;
 	
-	//print using screen coords
-	PushScreenCoordMat();
-
-	glPushAttrib(GL_LIST_BIT | GL_CURRENT_BIT  | GL_ENABLE_BIT | GL_TRANSFORM_BIT);
-	
-	glMatrixMode(GL_MODELVIEW);
-	glDisable(GL_LIGHTING);
 	glEnable(GL_TEXTURE_2D);
-	glDisable(GL_DEPTH_TEST);
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);	
-
-	glGetFloatv(GL_MODELVIEW_MATRIX, modelview_matrix);
 	
-	glPushMatrix();
+	if(g_sdf) {
+		cs_glUseProgram(g_sdf_prog);
+	}
 	
 	Frame_IterEnd(frm);
 	
 	//Unroll one loop iteration so we can get the cursor_x position.
-	//Don't draw it yet because of the current stack (attributes).
+	//Don't draw it yet, texturing is still on.
 	if(line < max_lines && (cur_line = Frame_IterPrev(frm))) {
-		cursor_x = draw_string(f, s, (float)x, (float)y - h*line, Line_Text(cur_line));
+		cursor_x = draw_text(fnt, (float)x, (float)y - h*line, Line_Text(cur_line));
 		++line;
 	}
 	
 	while(line < max_lines && (cur_line = Frame_IterPrev(frm))) {
-		draw_string(f, s, (float)x, (float)y - h*line, Line_Text(cur_line));
+		draw_text(fnt, (float)x, (float)y - h*line, Line_Text(cur_line));
 		++line;
 	}
 	
-	glPopMatrix();
+	if(g_sdf) {
+		cs_glUseProgram(0);
+	}
 	
-	glPopAttrib();
+	glDisable(GL_TEXTURE_2D);
 	
-	//Now draw the cursor (correct gl stack attributes)
+	//Now draw the cursor (untextured)
 	if(show_cursor) {
 		cursor_x = Fnt_PrintCursor(fnt, cursor_x, y);
 	}
 	
-	//go back to world coords
-	PopScreenCoordMat();
-	
 	return cursor_x;
 }
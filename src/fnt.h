@@ -47,6 +47,15 @@ Fnt_Width(Fnt * fnt);
 float
 Fnt_LineHeight(Fnt * fnt);
 
+/**********************************************************************
+ * returns how far any glyph reaches above/below the baseline
+ **********************************************************************/
+float
+Fnt_Ascent(Fnt * fnt);
+
+float
+Fnt_Descent(Fnt * fnt);
+
 /**********************************************************************
  * creates a fnt with a given name and size (in points)
  **********************************************************************/
@@ -69,5 +78,12 @@ Fnt_Print(Fnt * fnt, char * str, int x, int y, int show_cursor);
 float
 Fnt_PrintFrame(Fnt * fnt, Frame * frm, int x, int y, int max_lines, int show_cursor);
 
+/**********************************************************************
+ * draws text at (x,y) in the current GL state (no state changes)
+ **********************************************************************/
+
+float
+Fnt_DrawText(Fnt * fnt, char * str, float x, float y);
+
 
 #endif
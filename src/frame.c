@@ -33,8 +33,34 @@ struct frame_t {
 	Node * lines;
 	Node * cur_line;
 	int iter_end;
+	unsigned long stamp;
+	frame_stats_t stats;
+	frame_eol_t eol;
+	long size;      // bytes Frame_Write puts out
+	long saved;     // the text is as it was saved up to here
+	const char * imported;
 };
 
+// shared by all frames, so two frames never have the same stamp
+static unsigned long frame_stamp = 0;
+
+// indexed by frame_eol_t
+static const char * eol_chars[] = { "\n", "\r\n", "\r", "\xE2\x80\xA8", "\xE2\x80\xA9" };
+
+// the written text grew (or shrank, if negative) by bytes at its end
+static
+void
+Frame_Resize(Frame * frm, long bytes)
+{
+	long changed = (bytes < 0) ? frm->size + bytes : frm->size;
+	
+	if(changed < frm->saved) {
+		frm->saved = changed;
+	}
+	
+	frm->size += bytes;
+}
+
 static
 void
 Frame_AddLine(Frame * frm)
@@ -69,6 +95,124 @@ Frame_NumLines(Frame * frm)
 	return frm->num_lines;
 }
 
+unsigned long
+Frame_Stamp(Frame * frm)
+{
+	// edits only clear it, so frames can be built on another thread
+	if(!frm->stamp) {
+		frm->stamp = ++frame_stamp;
+	}
+	
+	return frm->stamp;
+}
+
+frame_stats_t
+Frame_Stats(Frame * frm)
+{
+	return frm->stats;
+}
+
+void
+Frame_SetEol(Frame * frm, frame_eol_t eol)
+{
+	if(eol != frm->eol) {
+		// every hard line end changes size, from the first one on
+		long ends = frm->stats.lines - 1;
+		
+		frm->size += ends * (long)(strlen(eol_chars[eol]) - strlen(eol_chars[frm->eol]));
+		frm->saved = 0;
+		frm->eol = eol;
+	}
+}
+
+frame_eol_t
+Frame_Eol(Frame * frm)
+{
+	return frm->eol;
+}
+
+long
+Frame_Size(Frame * frm)
+{
+	return frm->size;
+}
+
+long
+Frame_SavedUpTo(Frame * frm)
+{
+	return frm->saved;
+}
+
+void
+Frame_MarkSaved(Frame * frm)
+{
+	frm->saved = frm->size;
+	frm->imported = 0;
+}
+
+void
+Frame_SetImported(Frame * frm, const char * from)
+{
+	frm->imported = from;
+}
+
+const char*
+Frame_Imported(Frame * frm)
+{
+	return frm->imported;
+}
+
+
+/**************************************************************************
+ * Stats
+ *
+ * Text only ever changes at the end, so the counts only need to know
+ * what the last character is: a word starts when a non-space follows
+ * a space (or nothing), and goes away when that character is deleted.
+ * Hard line ends count as spaces; soft wraps aren't in the text at all.
+ **************************************************************************/
+
+// the last rune of the line (which isn't empty)
+static
+Rune
+Frame_LastRune(Line * line)
+{
+	Rune rune;
+	int i = line->len - 1;
+	
+	while(i > 0 && (line->text[i] & 0xC0) == 0x80) {
+		--i;
+	}
+	
+	chartorune(&rune, &line->text[i]);
+	
+	return rune;
+}
+
+// 1 if the text is empty or ends in a space (or a hard line end)
+static
+int
+Frame_EndsInSpace(Frame * frm)
+{
+	Node * node = frm->cur_line;
+	
+	while(node) {
+		Line * line = (Line *)node->data;
+		
+		if(line->len > 0) {
+			return isspacerune(Frame_LastRune(line));
+		}
+		
+		node = node->prev;
+		
+		if(node && ((Line *)node->data)->end == HARD) {
+			return 1;
+		}
+	}
+	
+	return 1;
+}
+
 Frame *
 Frame_Init()
 {
@@ -78,6 +222,14 @@ Frame_Init()
 	frm->cur_line = frm->lines;
 	frm->num_lines = 1;
 	frm->iter_end = 1;
+	frm->stamp = 0;
+	frm->stats.words = 0;
+	frm->stats.chars = 0;
+	frm->stats.lines = 1;
+	frm->eol = EOL_LF;
+	frm->size = 0;
+	frm->saved = 0;
+	frm->imported = 0;
 	
 	return frm;
 }
@@ -132,9 +284,10 @@ Frame_SoftWrap(Frame * frm)
 		
 		//update the full line with the appropriate data (new length, etc)
 		full_line->size -= strlen(&full_line->text[i]);
-		full_line->num_chars -= utflen(&full_line->text[i]);
+		full_line->num_chars -= utfcount(&full_line->text[i], full_line->len - i);
 		full_line->len = i;
 		full_line->text[i] = '\0';
+		Line_Touch(full_line);
 		//printf("full_line->size: %d, chars: %d, len: %d\n", full_line->size, full_line->num_chars, full_line->len);
 	}
 }
@@ -181,6 +334,22 @@ void
 Frame_InsertCh(Frame * frm, char * ch)
 {	
 	Line * cur_line = (Line *)frm->cur_line->data;
+	Rune rune;
+	
+	// a U+0000 (from a NUL in a file) comes in as "", which a line
+	// can't hold, so it isn't counted either
+	if(*ch == '\0') {
+		return;
+	}
+	
+	frm->stamp = 0;
+	
+	chartorune(&rune, ch);
+	if(!isspacerune(rune) && Frame_EndsInSpace(frm)) {
+		frm->stats.words += 1;
+	}
+	frm->stats.chars += 1;
+	Frame_Resize(frm, (long)strlen(ch));
 	
 	if(cur_line->num_chars < CHARS_PER_LINE) {
 		Line_InsertCh(cur_line, ch);
@@ -203,17 +372,35 @@ Frame_DeleteCh(Frame * frm)
 {
 	Line * cur_line = (Line *)frm->cur_line->data;
 	
+	frm->stamp = 0;
+	
 	if(cur_line->len > 0) {
+		Rune rune = Frame_LastRune(cur_line);
+		int len = cur_line->len;
+		
 		Line_DeleteCh(cur_line);
+		
+		Frame_Resize(frm, cur_line->len - len);
+		frm->stats.chars -= 1;
+		if(!isspacerune(rune) && Frame_EndsInSpace(frm)) {
+			frm->stats.words -= 1;
+		}
+		
 		Frame_UndoSoftWrap(frm);
-	} else {
+	} else if(frm->cur_line != frm->lines) {
 		Frame_DeleteLine(frm);
 		
 		cur_line = (Line *)frm->cur_line->data;
-		if(cur_line->end == SOFT && 
-			cur_line->num_chars > CHARS_PER_LINE && 
+		if(cur_line->end == HARD) {
+			// the line break itself was deleted, so it mustn't be written
+			cur_line->end = SOFT;
+			frm->stats.lines -= 1;
+			Frame_Resize(frm, -(long)strlen(eol_chars[frm->eol]));
+		} else if(cur_line->num_chars > CHARS_PER_LINE && 
 			cur_line->text[cur_line->len-1] == ' ') {
 			Line_DeleteCh(cur_line);
+			frm->stats.chars -= 1;
+			Frame_Resize(frm, -1);
 		}
 	}
 }
@@ -224,6 +411,10 @@ Frame_InsertNewLine(Frame * frm)
 	Line * cur_line = (Line *)frm->cur_line->data;
 	cur_line->end = HARD;
 	
+	frm->stamp = 0;
+	frm->stats.lines += 1;
+	Frame_Resize(frm, (long)strlen(eol_chars[frm->eol]));
+	
 	Frame_AddLine(frm);
 }
 
@@ -240,6 +431,40 @@ Frame_InsertTab(Frame * frm)
 }
 
 
+void
+Frame_Prepend(Frame * frm, Frame * head)
+{
+	Node * last = head->cur_line;
+	Node * first = frm->lines;
+	
+	// head ends in a hard line end, so its last line is empty and the
+	// wrapping of frm's first line doesn't change
+	assert(head->eol == frm->eol);
+	assert(last->prev && ((Line *)last->prev->data)->end == HARD);
+	assert(((Line *)last->data)->len == 0);
+	
+	Line_Destroy((Line *)last->data);
+	last = last->prev;
+	Node_Delete(last->next);
+	
+	last->next = first;
+	first->prev = last;
+	frm->lines = head->lines;
+	
+	frm->num_lines += head->num_lines - 1;
+	frm->stats.words += head->stats.words;
+	frm->stats.chars += head->stats.chars;
+	frm->stats.lines += head->stats.lines - 1;
+	
+	// frm is only as saved as far as head is
+	frm->saved = (head->saved == head->size) ? head->size + frm->saved : head->saved;
+	frm->size += head->size;
+	frm->stamp = 0;
+	
+	free(head);
+}
+
+
 /**************************************************************************
  * Iterator
  **************************************************************************/
@@ -313,25 +538,64 @@ Frame_IterPrev(Frame * frm)
  **************************************************************************/
 
 #define BUF_SIZE 4096
-#define EOL_SIZE 1
-#define HARD_CHAR '\n'
+
+// bytes the line takes up when written
+static
+long
+Frame_LineSize(Frame * frm, Line * line)
+{
+	return line->len + ((line->end == HARD) ? (long)strlen(eol_chars[frm->eol]) : 0);
+}
 
 void
-Frame_Write(Frame * frm, FILE * file)
+Frame_Write(Frame * frm, frame_write_t write, void * ctx)
+{
+	Frame_WriteFrom(frm, 0, write, ctx);
+}
+
+void
+Frame_WriteFrom(Frame * frm, long from, frame_write_t write, void * ctx)
 {
 	char buf[BUF_SIZE];
+	Node * node = frm->lines;
 	Line * cur_line;
+	long skip = from;
 	int len = 0;
 	int ptr = 0;
+	const char * eol = eol_chars[frm->eol];
+	int eol_size = (int)strlen(eol);
 	
-	Frame_IterBegin(frm);
+	// the text only changes at the end, so a tail is found from there
+	if(from > 0) {
+		long pos = frm->size - Frame_LineSize(frm, (Line *)frm->cur_line->data);
+		
+		node = frm->cur_line;
+		while(pos > from && node->prev) {
+			node = node->prev;
+			pos -= Frame_LineSize(frm, (Line *)node->data);
+		}
+		skip = from - pos;
+	}
+	
+	// the first line may start part way in
+	cur_line = (Line *)node->data;
+	if(skip < cur_line->len) {
+		write(ctx, &cur_line->text[skip], cur_line->len - (int)skip);
+		skip = 0;
+	} else {
+		skip -= cur_line->len;
+	}
+	if(cur_line->end == HARD && skip < eol_size) {
+		write(ctx, &eol[skip], eol_size - (int)skip);
+	}
 	
-	while((cur_line = Frame_IterNext(frm))) {
+	for(node = node->next; node; node = node->next) {
+		cur_line = (Line *)node->data;
 		len = cur_line->len;
 		
 		//flush the buffer if it is full
-		if(ptr + len + EOL_SIZE >= BUF_SIZE) {
-			fwrite(buf, sizeof(char), ptr, file);
+		if(ptr + len + eol_size >= BUF_SIZE) {
+			write(ctx, buf, ptr);
 			ptr = 0;
 		}
 		
@@ -341,11 +605,11 @@ Frame_Write(Frame * frm, FILE * file)
 		
 		//put the right character for EOL
 		if(cur_line->end == HARD) {
-			buf[ptr] = HARD_CHAR;
-			ptr += EOL_SIZE;
+			memcpy(&buf[ptr], eol, eol_size);
+			ptr += eol_size;
 		}
 	}
 	
 	//flush the buffer
-	fwrite(buf, sizeof(char), ptr, file);
+	write(ctx, buf, ptr);
 }
@@ -40,6 +40,23 @@
 
 typedef struct frame_t Frame;
 
+// running totals of the text; lines are the hard ones (Frame_NumLines
+// counts every soft wrapped one on screen)
+typedef struct {
+	long words;
+	long chars;
+	long lines;
+} frame_stats_t;
+
+// how the document's line ends are written out
+typedef enum {
+	EOL_LF,
+	EOL_CRLF,
+	EOL_CR,
+	EOL_LS,     // U+2028
+	EOL_PS      // U+2029
+} frame_eol_t;
+
 /************************************
  * Frame Operations
  ************************************/
@@ -47,6 +64,42 @@ typedef struct frame_t Frame;
 int
 Frame_NumLines(Frame * frm);
 
+// changes whenever the text changes (unique across frames); only ask
+// from one thread, though the frame can be built on any
+unsigned long
+Frame_Stamp(Frame * frm);
+
+// kept up to date by every edit, so it's free to ask for
+frame_stats_t
+Frame_Stats(Frame * frm);
+
+// new frames write EOL_LF; a loaded file keeps what it came with
+void
+Frame_SetEol(Frame * frm, frame_eol_t eol);
+
+frame_eol_t
+Frame_Eol(Frame * frm);
+
+// bytes Frame_Write puts out
+long
+Frame_Size(Frame * frm);
+
+// the written text is the same as at the last Frame_MarkSaved up to this
+// byte (Frame_Size if nothing changed since, 0 for a new frame)
+long
+Frame_SavedUpTo(Frame * frm);
+
+void
+Frame_MarkSaved(Frame * frm);
+
+// the encoding (a name) a loaded file was converted from, until the
+// frame's saved (as UTF-8); 0 if it was UTF-8 already
+void
+Frame_SetImported(Frame * frm, const char * from);
+
+const char*
+Frame_Imported(Frame * frm);
+
 Frame*
 Frame_Init();
 
@@ -65,6 +118,11 @@ Frame_InsertNewLine(Frame * frm);
 void
 Frame_InsertTab(Frame * frm);
 
+// puts the text of head (which ends in a hard line end) in front of
+// frm's, as if it had been typed first; head is freed
+void
+Frame_Prepend(Frame * frm, Frame * head);
+
 /************************************
  * Frame Iterator
  ************************************/
@@ -88,7 +146,14 @@ Frame_IterPrev(Frame * frm);
  * Frame I/O
  ************************************/
 
+// where Frame_Write sends the text, a block at a time
+typedef int (*frame_write_t)(void * ctx, const char * buf, int len);
+
+void
+Frame_Write(Frame * frm, frame_write_t write, void * ctx);
+
+// only what comes after the first from bytes
 void
-Frame_Write(Frame * frm, FILE * file);
+Frame_WriteFrom(Frame * frm, long from, frame_write_t write, void * ctx);
 
 #endif
@@ -0,0 +1,181 @@
+/*************************************************************************
+ * glproc.c -- Loads the OpenGL entry points newer than 1.1 at runtime.
+ *
+ * Candlestick App: Just Write. A minimalist, cross-platform writing app.
+ * Copyright (C) 2013 Thomas Klemz
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************************/
+
+#include "glproc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__APPLE__)
+#	include <dlfcn.h>
+#endif
+
+cs_glCreateShader_t       cs_glCreateShader = 0;
+cs_glShaderSource_t       cs_glShaderSource = 0;
+cs_glCompileShader_t      cs_glCompileShader = 0;
+cs_glGetShaderiv_t        cs_glGetShaderiv = 0;
+cs_glDeleteShader_t       cs_glDeleteShader = 0;
+cs_glCreateProgram_t      cs_glCreateProgram = 0;
+cs_glAttachShader_t       cs_glAttachShader = 0;
+cs_glLinkProgram_t        cs_glLinkProgram = 0;
+cs_glGetProgramiv_t       cs_glGetProgramiv = 0;
+cs_glUseProgram_t         cs_glUseProgram = 0;
+cs_glDeleteProgram_t      cs_glDeleteProgram = 0;
+cs_glGetUniformLocation_t cs_glGetUniformLocation = 0;
+cs_glUniform1i_t          cs_glUniform1i = 0;
+
+cs_glGenFramebuffers_t        cs_glGenFramebuffers = 0;
+cs_glDeleteFramebuffers_t     cs_glDeleteFramebuffers = 0;
+cs_glBindFramebuffer_t        cs_glBindFramebuffer = 0;
+cs_glFramebufferTexture2D_t   cs_glFramebufferTexture2D = 0;
+cs_glCheckFramebufferStatus_t cs_glCheckFramebufferStatus = 0;
+
+static int has_shaders = 0;
+static int has_framebuffers = 0;
+
+
+static
+void *
+GLProc_Get(const char * name)
+{
+#if defined(_WIN32)
+	return (void *)wglGetProcAddress(name);
+#elif defined(__APPLE__)
+	return dlsym(RTLD_DEFAULT, name);
+#else
+	return (void *)glXGetProcAddressARB((const GLubyte *)name);
+#endif
+}
+
+#define LOAD(type, name) (cs_##name = (type)GLProc_Get(#name))
+
+// core name first, then the EXT_framebuffer_object one
+#define LOAD_EXT(type, name) (LOAD(type, name) || \
+                              (cs_##name = (type)GLProc_Get(#name "EXT")))
+
+void
+GLProc_Init()
+{
+	const char * version = (const char *)glGetString(GL_VERSION);
+
+	// the entry points may resolve even when the driver can't use them
+	has_shaders = version && atoi(version) >= 2;
+
+	has_shaders = LOAD(cs_glCreateShader_t, glCreateShader) && has_shaders;
+	has_shaders = LOAD(cs_glShaderSource_t, glShaderSource) && has_shaders;
+	has_shaders = LOAD(cs_glCompileShader_t, glCompileShader) && has_shaders;
+	has_shaders = LOAD(cs_glGetShaderiv_t, glGetShaderiv) && has_shaders;
+	has_shaders = LOAD(cs_glDeleteShader_t, glDeleteShader) && has_shaders;
+	has_shaders = LOAD(cs_glCreateProgram_t, glCreateProgram) && has_shaders;
+	has_shaders = LOAD(cs_glAttachShader_t, glAttachShader) && has_shaders;
+	has_shaders = LOAD(cs_glLinkProgram_t, glLinkProgram) && has_shaders;
+	has_shaders = LOAD(cs_glGetProgramiv_t, glGetProgramiv) && has_shaders;
+	has_shaders = LOAD(cs_glUseProgram_t, glUseProgram) && has_shaders;
+	has_shaders = LOAD(cs_glDeleteProgram_t, glDeleteProgram) && has_shaders;
+	has_shaders = LOAD(cs_glGetUniformLocation_t, glGetUniformLocation) && has_shaders;
+	has_shaders = LOAD(cs_glUniform1i_t, glUniform1i) && has_shaders;
+
+	// the entry points alone don't say the driver supports them
+	has_framebuffers = (version && atoi(version) >= 3) ||
+		strstr((const char *)glGetString(GL_EXTENSIONS), "GL_EXT_framebuffer_object");
+
+	has_framebuffers = LOAD_EXT(cs_glGenFramebuffers_t, glGenFramebuffers) && has_framebuffers;
+	has_framebuffers = LOAD_EXT(cs_glDeleteFramebuffers_t, glDeleteFramebuffers) && has_framebuffers;
+	has_framebuffers = LOAD_EXT(cs_glBindFramebuffer_t, glBindFramebuffer) && has_framebuffers;
+	has_framebuffers = LOAD_EXT(cs_glFramebufferTexture2D_t, glFramebufferTexture2D) && has_framebuffers;
+	has_framebuffers = LOAD_EXT(cs_glCheckFramebufferStatus_t, glCheckFramebufferStatus) && has_framebuffers;
+}
+
+#undef LOAD_EXT
+#undef LOAD
+
+int
+GLProc_HasShaders()
+{
+	return has_shaders;
+}
+
+int
+GLProc_HasFramebuffers()
+{
+	return has_framebuffers;
+}
+
+
+static
+GLuint
+GLProc_Shader(GLenum type, const char * src)
+{
+	GLint ok = 0;
+	GLuint shader = cs_glCreateShader(type);
+
+	cs_glShaderSource(shader, 1, &src, NULL);
+	cs_glCompileShader(shader);
+	cs_glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+
+	if(!ok) {
+		fputs("GLSL shader failed to compile\n", stderr);
+		cs_glDeleteShader(shader);
+		shader = 0;
+	}
+
+	return shader;
+}
+
+GLuint
+GLProc_Program(const char * vert_src, const char * frag_src)
+{
+	GLint ok = 0;
+	GLuint vert;
+	GLuint frag;
+	GLuint prog = 0;
+
+	if(!has_shaders) {
+		return 0;
+	}
+
+	vert = GLProc_Shader(GL_VERTEX_SHADER, vert_src);
+	frag = GLProc_Shader(GL_FRAGMENT_SHADER, frag_src);
+
+	if(vert && frag) {
+		prog = cs_glCreateProgram();
+		cs_glAttachShader(prog, vert);
+		cs_glAttachShader(prog, frag);
+		cs_glLinkProgram(prog);
+		cs_glGetProgramiv(prog, GL_LINK_STATUS, &ok);
+
+		if(!ok) {
+			fputs("GLSL program failed to link\n", stderr);
+			cs_glDeleteProgram(prog);
+			prog = 0;
+		}
+	}
+
+	// the program keeps them alive
+	if(vert) {
+		cs_glDeleteShader(vert);
+	}
+	if(frag) {
+		cs_glDeleteShader(frag);
+	}
+
+	return prog;
+}
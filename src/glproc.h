@@ -0,0 +1,130 @@
+/*************************************************************************
+ * glproc.h -- Loads the OpenGL entry points newer than 1.1 at runtime.
+ *
+ * Candlestick App: Just Write. A minimalist, cross-platform writing app.
+ * Copyright (C) 2013 Thomas Klemz
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************************/
+
+#ifndef CS_GLPROC_H
+#define CS_GLPROC_H
+
+#include "opengl.h"
+
+/*
+ * Windows only ships an OpenGL 1.1 header, so anything newer has to be
+ * looked up by hand (and the enums defined by hand). Everything here
+ * is optional; callers fall back to the fixed-function path when the
+ * entry points are missing.
+ */
+
+#ifndef APIENTRY
+#	define APIENTRY
+#endif
+
+#ifndef GL_FRAGMENT_SHADER
+#	define GL_FRAGMENT_SHADER 0x8B30
+#	define GL_VERTEX_SHADER   0x8B31
+#	define GL_COMPILE_STATUS  0x8B81
+#	define GL_LINK_STATUS     0x8B82
+#endif
+
+#ifndef GL_FRAMEBUFFER
+#	define GL_FRAMEBUFFER          0x8D40
+#	define GL_COLOR_ATTACHMENT0    0x8CE0
+#	define GL_FRAMEBUFFER_COMPLETE 0x8CD5
+#endif
+
+typedef GLuint (APIENTRY * cs_glCreateShader_t)(GLenum type);
+typedef void (APIENTRY * cs_glShaderSource_t)(GLuint shader, GLsizei count, const char * const * str, const GLint * len);
+typedef void (APIENTRY * cs_glCompileShader_t)(GLuint shader);
+typedef void (APIENTRY * cs_glGetShaderiv_t)(GLuint shader, GLenum pname, GLint * params);
+typedef void (APIENTRY * cs_glDeleteShader_t)(GLuint shader);
+typedef GLuint (APIENTRY * cs_glCreateProgram_t)(void);
+typedef void (APIENTRY * cs_glAttachShader_t)(GLuint program, GLuint shader);
+typedef void (APIENTRY * cs_glLinkProgram_t)(GLuint program);
+typedef void (APIENTRY * cs_glGetProgramiv_t)(GLuint program, GLenum pname, GLint * params);
+typedef void (APIENTRY * cs_glUseProgram_t)(GLuint program);
+typedef void (APIENTRY * cs_glDeleteProgram_t)(GLuint program);
+typedef GLint (APIENTRY * cs_glGetUniformLocation_t)(GLuint program, const char * name);
+typedef void (APIENTRY * cs_glUniform1i_t)(GLint location, GLint v0);
+typedef void (APIENTRY * cs_glGenFramebuffers_t)(GLsizei n, GLuint * ids);
+typedef void (APIENTRY * cs_glDeleteFramebuffers_t)(GLsizei n, const GLuint * ids);
+typedef void (APIENTRY * cs_glBindFramebuffer_t)(GLenum target, GLuint id);
+typedef void (APIENTRY * cs_glFramebufferTexture2D_t)(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level);
+typedef GLenum (APIENTRY * cs_glCheckFramebufferStatus_t)(GLenum target);
+
+extern cs_glCreateShader_t       cs_glCreateShader;
+extern cs_glShaderSource_t       cs_glShaderSource;
+extern cs_glCompileShader_t      cs_glCompileShader;
+extern cs_glGetShaderiv_t        cs_glGetShaderiv;
+extern cs_glDeleteShader_t       cs_glDeleteShader;
+extern cs_glCreateProgram_t      cs_glCreateProgram;
+extern cs_glAttachShader_t       cs_glAttachShader;
+extern cs_glLinkProgram_t        cs_glLinkProgram;
+extern cs_glGetProgramiv_t       cs_glGetProgramiv;
+extern cs_glUseProgram_t         cs_glUseProgram;
+extern cs_glDeleteProgram_t      cs_glDeleteProgram;
+extern cs_glGetUniformLocation_t cs_glGetUniformLocation;
+extern cs_glUniform1i_t          cs_glUniform1i;
+
+extern cs_glGenFramebuffers_t        cs_glGenFramebuffers;
+extern cs_glDeleteFramebuffers_t     cs_glDeleteFramebuffers;
+extern cs_glBindFramebuffer_t        cs_glBindFramebuffer;
+extern cs_glFramebufferTexture2D_t   cs_glFramebufferTexture2D;
+extern cs_glCheckFramebufferStatus_t cs_glCheckFramebufferStatus;
+
+
+/**********************************************************************
+ * GLProc_Init
+ *
+ * looks up every entry point; needs a current context
+ **********************************************************************/
+
+void
+GLProc_Init();
+
+
+/**********************************************************************
+ * GLProc_HasShaders
+ *
+ * returns nonzero if GLSL programs can be used
+ **********************************************************************/
+
+int
+GLProc_HasShaders();
+
+
+/**********************************************************************
+ * GLProc_HasFramebuffers
+ *
+ * returns nonzero if textures can be rendered to (GL 3.0 or
+ * EXT_framebuffer_object)
+ **********************************************************************/
+
+int
+GLProc_HasFramebuffers();
+
+
+/**********************************************************************
+ * GLProc_Program
+ *
+ * compiles and links a vertex/fragment pair; returns 0 on failure
+ **********************************************************************/
+
+GLuint
+GLProc_Program(const char * vert_src, const char * frag_src);
+
+#endif
@@ -0,0 +1,689 @@
+/*************************************************************************
+ * history.c -- Saved drafts of every document, kept deduplicated.
+ *
+ * Candlestick App: Just Write. A minimalist, cross-platform writing app.
+ * Copyright (C) 2013 Thomas Klemz
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************************/
+
+#include "history.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#elif defined(_WIN32)
+#  include <windows.h>
+#endif
+
+/* Every chunk any draft has had is stored once, one after another, in
+ * the pack; the index says where each one is (by its hash). A document's
+ * drafts are a list of chunk numbers each, appended to its own file.
+ * Everything is only ever appended, and what's read back is checked, so
+ * a write that was cut short loses no more than that draft.
+ */
+
+#define HISTORY_PACK HISTORY_DIR "chunks.pack"
+#define HISTORY_INDEX HISTORY_DIR "chunks.idx"
+#define HISTORY_EXT ".snap"
+
+// chunks are cut where the rolling hash's top 13 bits are 0 (8k apart
+// on average), but never shorter than CHUNK_MIN or longer than CHUNK_MAX
+#define CHUNK_MIN 2048
+#define CHUNK_MAX 65536
+#define CHUNK_MASK (0x1FFFULL << 51)
+
+#define SNAP_MAGIC 0x50414E53     // "SNAP"
+
+typedef struct {
+	unsigned long long hash[2];
+	unsigned long long off;     // in the pack
+	unsigned int len;
+	unsigned int unused;
+} chunk_t;
+
+typedef struct {
+	unsigned int magic;
+	unsigned int count;         // chunk numbers that follow
+	unsigned long long when;
+	unsigned long long size;
+} snap_t;
+
+typedef struct {
+	snap_t head;
+	long at;                    // where its chunk numbers start
+} snap_pos_t;
+
+typedef struct {
+	char * text;
+	long len;
+} fill_t;
+
+static chunk_t * chunks = 0;
+static int num_chunks = 0;
+static int chunks_cap = 0;
+static int * slots = 0;         // open addressing, chunk number + 1
+static int num_slots = 0;
+static unsigned long long pack_size = 0;
+static int loaded = 0;
+
+// random numbers the rolling hash adds in for every byte
+static unsigned long long gear[256];
+
+// the last draft taken, so the next one of the same document only has
+// to cut up the part that changed
+static char * last_name = 0;
+static unsigned int * last_ids = 0;
+static long * last_ends = 0;    // where each chunk ends in the text
+static int last_count = 0;
+
+
+/**************************************************************************
+ * Chunking
+ **************************************************************************/
+
+static
+void
+History_InitGear()
+{
+	unsigned long long x = 0x2545F4914F6CDD1DULL;
+	int i;
+
+	// splitmix64, so every build cuts in the same places
+	for(i = 0; i < 256; ++i) {
+		unsigned long long z = (x += 0x9E3779B97F4A7C15ULL);
+
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		gear[i] = z ^ (z >> 31);
+	}
+}
+
+// the length of the chunk at the start of p (len bytes are left)
+static
+long
+History_Cut(const unsigned char * p, long len)
+{
+	unsigned long long h = 0;
+	long i;
+
+	if(len <= CHUNK_MIN) {
+		return len;
+	}
+	if(len > CHUNK_MAX) {
+		len = CHUNK_MAX;
+	}
+
+	// each shift pushes the oldest byte out the top, so the top bits
+	// only depend on the last 64 bytes: the same text cuts the same
+	// way wherever it is
+	for(i = CHUNK_MIN; i < len; ++i) {
+		h = (h << 1) + gear[p[i]];
+
+		if(!(h & CHUNK_MASK)) {
+			return i + 1;
+		}
+	}
+
+	return len;
+}
+
+static
+unsigned long long
+History_Mix(unsigned long long h)
+{
+	h ^= h >> 33;
+	h *= 0xFF51AFD7ED558CCDULL;
+	h ^= h >> 33;
+	h *= 0xC4CEB9FE1A85EC53ULL;
+	h ^= h >> 33;
+
+	return h;
+}
+
+// 128 bits, so chunks can be told apart by their hash alone
+static
+void
+History_Hash(const unsigned char * p, long len, unsigned long long hash[2])
+{
+	unsigned long long a = 0x9E3779B97F4A7C15ULL ^ (unsigned long long)len;
+	unsigned long long b = 0xC2B2AE3D27D4EB4FULL + (unsigned long long)len;
+	unsigned long long w;
+	long i;
+
+	for(i = 0; i + 8 <= len; i += 8) {
+		memcpy(&w, &p[i], 8);
+		a = (a ^ w) * 0x87C37B91114253D5ULL;
+		a = (a << 31) | (a >> 33);
+		b = (b ^ w) * 0x4CF5AD432745937FULL;
+		b = (b << 27) | (b >> 37);
+	}
+
+	w = 0;
+	memcpy(&w, &p[i], len - i);
+	a ^= w;
+	b += w;
+
+	hash[0] = History_Mix(a ^ History_Mix(b));
+	hash[1] = History_Mix(b + hash[0]);
+}
+
+
+/**************************************************************************
+ * Chunk index
+ **************************************************************************/
+
+static
+unsigned int
+History_Slot(const unsigned long long hash[2])
+{
+	return (unsigned int)hash[0] & (num_slots - 1);
+}
+
+static
+void
+History_Rehash()
+{
+	int i;
+
+	free(slots);
+	num_slots = num_slots ? num_slots * 2 : 4096;
+	slots = (int *)calloc(num_slots, sizeof(int));
+
+	for(i = 0; i < num_chunks; ++i) {
+		unsigned int s = History_Slot(chunks[i].hash);
+
+		while(slots[s]) {
+			s = (s + 1) & (num_slots - 1);
+		}
+		slots[s] = i + 1;
+	}
+}
+
+// the number of the chunk, or -1 if it's new
+static
+int
+History_Find(const unsigned long long hash[2], long len)
+{
+	unsigned int s = History_Slot(hash);
+
+	while(slots[s]) {
+		chunk_t * c = &chunks[slots[s] - 1];
+
+		if(c->hash[0] == hash[0] && c->hash[1] == hash[1] && c->len == len) {
+			return slots[s] - 1;
+		}
+		s = (s + 1) & (num_slots - 1);
+	}
+
+	return -1;
+}
+
+static
+int
+History_Add(const unsigned long long hash[2], long len, unsigned long long off)
+{
+	chunk_t * c;
+	unsigned int s;
+
+	if(num_chunks == chunks_cap) {
+		chunks_cap = chunks_cap ? chunks_cap * 2 : 1024;
+		chunks = (chunk_t *)realloc(chunks, chunks_cap * sizeof(chunk_t));
+	}
+
+	c = &chunks[num_chunks++];
+	c->hash[0] = hash[0];
+	c->hash[1] = hash[1];
+	c->off = off;
+	c->len = (unsigned int)len;
+	c->unused = 0;
+
+	// keep the table at most half full
+	if(num_chunks * 2 > num_slots) {
+		History_Rehash();
+	} else {
+		s = History_Slot(hash);
+		while(slots[s]) {
+			s = (s + 1) & (num_slots - 1);
+		}
+		slots[s] = num_chunks;
+	}
+
+	return num_chunks - 1;
+}
+
+static
+long
+History_FileSize(FILE * file)
+{
+	long size;
+
+	fseek(file, 0, SEEK_END);
+	size = ftell(file);
+	rewind(file);
+
+	return size;
+}
+
+// reads the index in once; anything past the end of the pack is dropped
+static
+void
+History_Load()
+{
+	FILE * file;
+	chunk_t c;
+
+	if(loaded) {
+		return;
+	}
+
+	History_InitGear();
+	num_chunks = 0;
+	num_slots = 0;
+	pack_size = 0;
+	History_Rehash();
+
+	if((file = fopen(HISTORY_PACK, "rb"))) {
+		pack_size = (unsigned long long)History_FileSize(file);
+		fclose(file);
+	}
+
+	if((file = fopen(HISTORY_INDEX, "rb"))) {
+		while(fread(&c, sizeof(chunk_t), 1, file) == 1 &&
+			c.off + c.len <= pack_size) {
+			History_Add(c.hash, c.len, c.off);
+		}
+		fclose(file);
+	}
+
+	loaded = 1;
+}
+
+static
+void
+History_Forget()
+{
+	free(last_name);
+	last_name = 0;
+	free(last_ids);
+	last_ids = 0;
+	free(last_ends);
+	last_ends = 0;
+	last_count = 0;
+}
+
+void
+History_Cleanup()
+{
+	History_Forget();
+
+	free(chunks);
+	chunks = 0;
+	num_chunks = 0;
+	chunks_cap = 0;
+
+	free(slots);
+	slots = 0;
+	num_slots = 0;
+
+	loaded = 0;
+}
+
+
+/**************************************************************************
+ * Files
+ **************************************************************************/
+
+static
+void
+History_CheckDir()
+{
+	Files_CheckDocDir();
+
+#if defined(__unix__) || defined(__APPLE__)
+	{
+		struct stat st = {0};
+
+		if(stat(HISTORY_DIR, &st) == -1) {
+			mkdir(HISTORY_DIR, (S_IRWXU | S_IRWXG | S_IRWXO));
+		}
+	}
+#elif defined(_WIN32)
+	{
+		CreateDirectory(HISTORY_DIR, NULL);
+	}
+#endif
+}
+
+static
+char *
+History_Path(char * name)
+{
+	char * path = (char *)malloc(strlen(HISTORY_DIR) + strlen(name) + strlen(HISTORY_EXT) + 1);
+
+	strcpy(path, HISTORY_DIR);
+	strcat(path, name);
+	strcat(path, HISTORY_EXT);
+
+	return path;
+}
+
+// opens a file to write at (anything already there after it is
+// overwritten, or left to be ignored by the reader)
+static
+FILE *
+History_OpenAt(char * path, long at)
+{
+	FILE * file = fopen(path, "r+b");
+
+	if(!file && !at) {
+		file = fopen(path, "wb");
+	}
+
+	if(file && fseek(file, at, SEEK_SET)) {
+		fclose(file);
+		file = 0;
+	}
+
+	return file;
+}
+
+// the drafts in a document's file, up to the first that isn't whole;
+// *end is where that is
+static
+snap_pos_t *
+History_Snaps(FILE * file, int * num, long * end)
+{
+	snap_pos_t * snaps = 0;
+	int cap = 0;
+	long size = History_FileSize(file);
+	snap_t head;
+
+	*num = 0;
+	*end = 0;
+
+	while(fread(&head, sizeof(snap_t), 1, file) == 1 && head.magic == SNAP_MAGIC) {
+		long at = *end + (long)sizeof(snap_t);
+		long next = at + (long)head.count * (long)sizeof(unsigned int);
+
+		if(next > size || fseek(file, next, SEEK_SET)) {
+			break;
+		}
+
+		if(*num == cap) {
+			cap = cap ? cap * 2 : 64;
+			snaps = (snap_pos_t *)realloc(snaps, cap * sizeof(snap_pos_t));
+		}
+
+		snaps[*num].head = head;
+		snaps[*num].at = at;
+		*num += 1;
+		*end = next;
+	}
+
+	return snaps;
+}
+
+static
+unsigned int *
+History_ReadIds(FILE * file, snap_pos_t * snap)
+{
+	unsigned int * ids = (unsigned int *)malloc((snap->head.count + 1) * sizeof(unsigned int));
+
+	if(fseek(file, snap->at, SEEK_SET) ||
+		fread(ids, sizeof(unsigned int), snap->head.count, file) != snap->head.count) {
+		free(ids);
+		return 0;
+	}
+
+	return ids;
+}
+
+
+/**************************************************************************
+ * Snapshot
+ **************************************************************************/
+
+static
+int
+History_Fill(void * ctx, const char * buf, int len)
+{
+	fill_t * fill = (fill_t *)ctx;
+
+	memcpy(&fill->text[fill->len], buf, len);
+	fill->len += len;
+
+	return 1;
+}
+
+// the draft's chunk numbers go on the end of the document's file,
+// unless they're what's there last already
+static
+int
+History_AddSnap(char * name, unsigned int * ids, int count, long size)
+{
+	char * path = History_Path(name);
+	FILE * file = fopen(path, "rb");
+	snap_pos_t * snaps = 0;
+	int num = 0;
+	long end = 0;
+	int ok = 1;
+
+	if(file) {
+		snaps = History_Snaps(file, &num, &end);
+
+		if(num > 0 && snaps[num - 1].head.count == (unsigned int)count &&
+			snaps[num - 1].head.size == (unsigned long long)size) {
+			unsigned int * last = History_ReadIds(file, &snaps[num - 1]);
+
+			if(last && !memcmp(last, ids, count * sizeof(unsigned int))) {
+				ok = -1;
+			}
+			free(last);
+		}
+		fclose(file);
+	}
+
+	if(ok > 0) {
+		snap_t head;
+
+		head.magic = SNAP_MAGIC;
+		head.count = (unsigned int)count;
+		head.when = (unsigned long long)time(NULL);
+		head.size = (unsigned long long)size;
+
+		file = History_OpenAt(path, end);
+		ok = file && fwrite(&head, sizeof(snap_t), 1, file) == 1 &&
+			(int)fwrite(ids, sizeof(unsigned int), count, file) == count;
+		ok = file && (fclose(file) == 0) && ok;
+	}
+
+	free(snaps);
+	free(path);
+
+	return ok != 0;
+}
+
+int
+History_Snapshot(char * name, Frame * frm, long from)
+{
+	fill_t fill;
+	unsigned int * ids;
+	long * ends;
+	int count = 0;
+	int first_new;
+	long start = 0;
+	long pos;
+	long cut;
+	FILE * pack;
+	FILE * index;
+	int ok;
+
+	// the chunks that end before the change are the same as last time,
+	// but for the last one, which only ended there because the text did
+	if(from > 0 && last_name && !strcmp(last_name, name)) {
+		while(count < last_count - 1 && last_ends[count] <= from) {
+			start = last_ends[count];
+			++count;
+		}
+	}
+
+	fill.text = (char *)malloc(Frame_Size(frm) - start + 1);
+	fill.len = 0;
+	if(!fill.text) {
+		return 0;
+	}
+	Frame_WriteFrom(frm, start, History_Fill, &fill);
+
+	ids = (unsigned int *)malloc((count + fill.len / CHUNK_MIN + 1) * sizeof(unsigned int));
+	ends = (long *)malloc((count + fill.len / CHUNK_MIN + 1) * sizeof(long));
+	if(count > 0) {
+		memcpy(ids, last_ids, count * sizeof(unsigned int));
+		memcpy(ends, last_ends, count * sizeof(long));
+	}
+
+	History_CheckDir();
+	History_Load();
+	first_new = num_chunks;
+
+	pack = History_OpenAt(HISTORY_PACK, (long)pack_size);
+	ok = (pack != 0);
+
+	for(pos = 0; ok && pos < fill.len; pos += cut) {
+		const unsigned char * p = (const unsigned char *)&fill.text[pos];
+		unsigned long long hash[2];
+		int id;
+
+		cut = History_Cut(p, fill.len - pos);
+		History_Hash(p, cut, hash);
+
+		// only chunks no draft had yet are written
+		id = History_Find(hash, cut);
+		if(id < 0) {
+			ok = (fwrite(p, 1, cut, pack) == (size_t)cut);
+			id = History_Add(hash, cut, pack_size);
+			pack_size += cut;
+		}
+
+		ids[count] = (unsigned int)id;
+		ends[count] = start + pos + cut;
+		++count;
+	}
+
+	// the pack has to be there before the index points into it, and
+	// both before a draft uses them
+	ok = pack && (fclose(pack) == 0) && ok;
+
+	if(ok && num_chunks > first_new) {
+		index = History_OpenAt(HISTORY_INDEX, first_new * (long)sizeof(chunk_t));
+		ok = index && (int)fwrite(&chunks[first_new], sizeof(chunk_t),
+			num_chunks - first_new, index) == num_chunks - first_new;
+		ok = index && (fclose(index) == 0) && ok;
+	}
+
+	ok = ok && History_AddSnap(name, ids, count, start + fill.len);
+
+	if(ok) {
+		if(!last_name || strcmp(last_name, name)) {
+			free(last_name);
+			last_name = (char *)malloc(strlen(name) + 1);
+			strcpy(last_name, name);
+		}
+		free(last_ids);
+		free(last_ends);
+		last_ids = ids;
+		last_ends = ends;
+		last_count = count;
+	} else {
+		// read it all in again, as far as it got
+		History_Cleanup();
+		free(ids);
+		free(ends);
+		fprintf(stderr, "Could not save a snapshot of %s!\n", name);
+	}
+
+	free(fill.text);
+
+	return ok;
+}
+
+
+/**************************************************************************
+ * Restore
+ **************************************************************************/
+
+char*
+History_Restore(char * name, int back, long * len, time_t * when)
+{
+	char * path = History_Path(name);
+	FILE * file = fopen(path, "rb");
+	FILE * pack = 0;
+	snap_pos_t * snaps = 0;
+	unsigned int * ids = 0;
+	char * text = 0;
+	int num = 0;
+	long end;
+	long size = 0;
+	unsigned int i;
+
+	free(path);
+
+	if(!file) {
+		return 0;
+	}
+
+	snaps = History_Snaps(file, &num, &end);
+
+	if(back >= 0 && back < num) {
+		snap_pos_t * snap = &snaps[num - 1 - back];
+
+		ids = History_ReadIds(file, snap);
+		History_Load();
+		pack = fopen(HISTORY_PACK, "rb");
+		text = (char *)malloc(snap->head.size + 1);
+
+		for(i = 0; ids && pack && text && i < snap->head.count; ++i) {
+			chunk_t * c = (ids[i] < (unsigned int)num_chunks) ? &chunks[ids[i]] : 0;
+
+			if(!c || size + c->len > (long)snap->head.size ||
+				fseek(pack, (long)c->off, SEEK_SET) ||
+				fread(&text[size], 1, c->len, pack) != c->len) {
+				break;
+			}
+			size += c->len;
+		}
+
+		if(text && size != (long)snap->head.size) {
+			fprintf(stderr, "The snapshot of %s is damaged!\n", name);
+			free(text);
+			text = 0;
+		}
+
+		*len = size;
+		*when = (time_t)snap->head.when;
+	}
+
+	if(pack) {
+		fclose(pack);
+	}
+	fclose(file);
+	free(ids);
+	free(snaps);
+
+	return text;
+}
@@ -0,0 +1,65 @@
+/*************************************************************************
+ * history.h -- Saved drafts of every document, kept deduplicated.
+ *
+ * Candlestick App: Just Write. A minimalist, cross-platform writing app.
+ * Copyright (C) 2013 Thomas Klemz
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************************/
+
+#ifndef CS_HISTORY_H
+#define CS_HISTORY_H
+
+#include "files.h"
+#include "frame.h"
+
+#include <time.h>
+
+// the snapshots sit next to the documents folder
+#define HISTORY_DIR DOCS_FOLDER "../history/"
+
+
+/**************************************************************************
+ * Snapshot
+ *
+ * Records the frame as a new draft of the document (name with
+ * extension). The text is cut into chunks where its content says to
+ * (a rolling hash), so an edit only changes the chunks around it; a
+ * chunk that's been stored before, by any draft of any document, is
+ * only referred to again. Nothing is recorded if the text is the same
+ * as the last draft. from is how far the text is the same as the last
+ * draft taken of this document (0 if that isn't known): only what
+ * comes after the chunk it's in needs to be looked at. Returns 0 if it
+ * couldn't be written.
+ **************************************************************************/
+
+int
+History_Snapshot(char * name, Frame * frm, long from);
+
+
+/**************************************************************************
+ * Restore
+ *
+ * Returns a draft of the document as a malloc'd buffer of *len bytes,
+ * back drafts before the newest one (0 is the newest), along with when
+ * it was saved. 0 if there aren't that many.
+ **************************************************************************/
+
+char*
+History_Restore(char * name, int back, long * len, time_t * when);
+
+void
+History_Cleanup();
+
+#endif
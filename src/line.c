@@ -8,6 +8,28 @@
 #include <stdio.h>
 #include <string.h>
 
+// Shared by every line so that a stamp is never reused, even when a
+// destroyed line's memory is handed to a new one. An edit only clears
+// the line's stamp; the next one is handed out when it's asked for, so
+// a frame can be built on another thread without touching this.
+static unsigned long line_stamp = 0;
+
+void
+Line_Touch(Line * line)
+{
+	line->stamp = 0;
+}
+
+unsigned long
+Line_Stamp(Line * line)
+{
+	if(!line->stamp) {
+		line->stamp = ++line_stamp;
+	}
+	
+	return line->stamp;
+}
+
 //should rename to Line_TextRaw or something
 char*
 Line_Text(Line * line)
@@ -25,6 +47,7 @@ Line_Init(int init_size)
 	line->len = 0;
 	line->num_chars = 0;
 	line->end = SOFT;
+	Line_Touch(line);
 	
 	return line;
 }
@@ -57,6 +80,7 @@ Line_InsertCh(Line * line, char * ch)
 		}
 		
 		line->num_chars += 1; //inserted one unicode character
+		Line_Touch(line);
 	}
 }
 
@@ -117,6 +141,7 @@ Line_DeleteCh(Line * line)
 		line->len = cur;
 		line->text[cur] = '\0';
 		line->num_chars -= 1; //deleted one unicode character
+		Line_Touch(line);
 	}
 }
 
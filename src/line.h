@@ -14,6 +14,7 @@ typedef struct line_t {
 	int size;      //current size (bytes)
 	int num_chars; //number of unicode chars (not bytes)
 	LINE_END end;
+	unsigned long stamp; //0 after an edit (see Line_Stamp)
 } Line;
 
 
@@ -40,4 +41,12 @@ Line_InsertStr(Line * line, char * str);
 void
 Line_DeleteCh(Line * line);
 
+//marks the line as changed (for callers that edit the fields directly)
+void
+Line_Touch(Line * line);
+
+//changes on every edit; unique across all lines (only ask from one thread)
+unsigned long
+Line_Stamp(Line * line);
+
 #endif
@@ -0,0 +1,213 @@
+/*************************************************************************
+ * loader.c -- Fills in the start of a long document in the background.
+ *
+ * Candlestick App: Just Write. A minimalist, cross-platform writing app.
+ * Copyright (C) 2013 Thomas Klemz
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************************/
+
+#include "loader.h"
+#include "thread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* One thread per document, which fills the pieces in order and ends.
+ * The pieces' bounds are worked out before it starts and never change;
+ * how many are filled is guarded by the lock.
+ */
+
+static cs_mutex_t lock;
+static cs_cond_t filled;        // broadcast as each piece is
+static int lock_ready = 0;
+static cs_thread_t thread;
+static int started = 0;         // there's a thread to join
+static int quit = 0;
+
+static char * text = 0;
+static long text_len = 0;
+static loader_fill_t filler = 0;
+static void * filler_arg = 0;
+
+static int num_pieces = 0;
+static long * starts = 0;       // piece i is text[starts[i]..starts[i - 1])
+static Frame ** pieces = 0;
+static int num_filled = 0;
+static int num_taken = 0;
+
+
+static
+void
+Loader_Main(void * arg)
+{
+	int i;
+
+	for(i = 0; i < num_pieces; ++i) {
+		long end = (i > 0) ? starts[i - 1] : text_len;
+		Frame * piece;
+
+		Mutex_Lock(&lock);
+		if(quit) {
+			Mutex_Unlock(&lock);
+			break;
+		}
+		Mutex_Unlock(&lock);
+
+		piece = filler(&text[starts[i]], end - starts[i], filler_arg);
+
+		Mutex_Lock(&lock);
+		pieces[i] = piece;
+		num_filled = i + 1;
+		Cond_Broadcast(&filled);
+		Mutex_Unlock(&lock);
+	}
+}
+
+// lets go of the thread and whatever wasn't taken
+static
+void
+Loader_Stop()
+{
+	int i;
+
+	if(!started) {
+		return;
+	}
+
+	Mutex_Lock(&lock);
+	quit = 1;
+	Mutex_Unlock(&lock);
+
+	Thread_Join(&thread);
+	started = 0;
+	quit = 0;
+
+	for(i = num_taken; i < num_filled; ++i) {
+		if(pieces[i]) {
+			Frame_Destroy(pieces[i]);
+		}
+	}
+
+	free(text);
+	free(starts);
+	free(pieces);
+	text = 0;
+	starts = 0;
+	pieces = 0;
+	num_pieces = 0;
+	num_filled = 0;
+	num_taken = 0;
+}
+
+int
+Loader_Start(char * the_text, long len, loader_fill_t fill, void * arg)
+{
+	long end = len;
+	int max_pieces = (int)(len / LOADER_PIECE) + 2;
+
+	Loader_Stop();
+
+	if(!lock_ready) {
+		Mutex_Init(&lock);
+		Cond_Init(&filled);
+		lock_ready = 1;
+	}
+
+	text = the_text;
+	text_len = len;
+	filler = fill;
+	filler_arg = arg;
+
+	// from the end backwards, each piece starting after a '\n' (a piece
+	// is longer if a line is)
+	starts = (long *)malloc(max_pieces * sizeof(long));
+	num_pieces = 0;
+	while(end > 0) {
+		long start = (end > LOADER_PIECE) ? end - LOADER_PIECE : 0;
+
+		while(start > 0 && text[start - 1] != '\n') {
+			--start;
+		}
+
+		starts[num_pieces++] = start;
+		end = start;
+	}
+
+	pieces = (Frame **)calloc(num_pieces + 1, sizeof(Frame *));
+	num_filled = 0;
+	num_taken = 0;
+
+	if(!Thread_Start(&thread, Loader_Main, 0)) {
+		fputs("Could not start the loading thread!\n", stderr);
+
+		free(starts);
+		free(pieces);
+		text = 0;
+		starts = 0;
+		pieces = 0;
+		num_pieces = 0;
+
+		return 0;
+	}
+
+	started = 1;
+
+	return 1;
+}
+
+Frame*
+Loader_Next(int wait, int * more)
+{
+	Frame * piece = 0;
+	int ready;
+
+	*more = 0;
+
+	if(!started) {
+		return 0;
+	}
+
+	Mutex_Lock(&lock);
+	while(wait && num_taken < num_pieces && num_filled == num_taken) {
+		Cond_Wait(&filled, &lock);
+	}
+	ready = (num_taken < num_filled);
+	Mutex_Unlock(&lock);
+
+	if(ready) {
+		piece = pieces[num_taken++];
+	}
+
+	// the last one's out, so the text can go
+	if(num_taken == num_pieces) {
+		Loader_Stop();
+	} else {
+		*more = 1;
+	}
+
+	return piece;
+}
+
+void
+Loader_Cleanup()
+{
+	Loader_Stop();
+
+	if(lock_ready) {
+		Cond_Destroy(&filled);
+		Mutex_Destroy(&lock);
+		lock_ready = 0;
+	}
+}
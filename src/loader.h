@@ -0,0 +1,65 @@
+/*************************************************************************
+ * loader.h -- Fills in the start of a long document in the background.
+ *
+ * Candlestick App: Just Write. A minimalist, cross-platform writing app.
+ * Copyright (C) 2013 Thomas Klemz
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************************/
+
+#ifndef CS_LOADER_H
+#define CS_LOADER_H
+
+#include "frame.h"
+
+// about how much text each piece the loader hands back holds (bytes)
+#define LOADER_PIECE (1 << 20)
+
+// makes a frame of len bytes of text, which starts a line; it's called
+// on another thread, so it mustn't touch anything shared
+typedef Frame* (*loader_fill_t)(char * text, long len, void * arg);
+
+
+/**************************************************************************
+ * Start
+ *
+ * Starts filling frames from the malloc'd text (len bytes, ending in a
+ * '\n') on another thread, a piece of about LOADER_PIECE at a time. The
+ * pieces are split after a '\n', where a frame's wrapping starts over,
+ * and are filled from the end of the text backwards, so what's nearest
+ * the text after it comes first. The text and arg are the loader's
+ * until Loader_Next returns 0 (it frees the text); 0 if it couldn't be
+ * started, and the text is still the caller's.
+ **************************************************************************/
+
+int
+Loader_Start(char * text, long len, loader_fill_t fill, void * arg);
+
+
+/**************************************************************************
+ * Next
+ *
+ * Returns the next piece, now the caller's, to go in front of the ones
+ * before it. If it isn't filled yet, waits for it if wait is set, or
+ * returns 0 with *more set. Once every piece has been taken (or nothing
+ * was started), returns 0 with *more cleared.
+ **************************************************************************/
+
+Frame*
+Loader_Next(int wait, int * more);
+
+void
+Loader_Cleanup();
+
+#endif
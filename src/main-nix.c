@@ -24,6 +24,7 @@
 #include <pthread.h>
 #include <sys/time.h>
 #include <unistd.h>
+#include <math.h>
 
 #include "opengl.h"
 #include "app.h"
@@ -32,6 +33,7 @@
 #include "timesub.h"
 
 #include <X11/Xatom.h>
+#include <X11/Xresource.h>
 
 
 static Display * dpy;
@@ -126,6 +128,66 @@ stopLoop()
 }
 
 
+/**************************************************************************
+ * QueryScale
+ *
+ * Desktops publish their scaling through Xft.dpi in the RESOURCE_MANAGER
+ * property of the root window. Read the property itself (rather than
+ * XResourceManagerString, which is a copy made when the display was
+ * opened) so that changes made while running are seen too. Without it,
+ * fall back to the physical size of the screen.
+ **************************************************************************/
+
+static
+float
+QueryScale()
+{
+	static int xrm_init = 0;
+	float dpi = 0.0f;
+	float scale;
+	Atom type;
+	int format;
+	unsigned long num_items;
+	unsigned long bytes_after;
+	unsigned char * data = NULL;
+
+	if(!xrm_init) {
+		XrmInitialize();
+		xrm_init = 1;
+	}
+
+	if(XGetWindowProperty(dpy, root, XA_RESOURCE_MANAGER, 0, 1 << 16, False,
+			XA_STRING, &type, &format, &num_items, &bytes_after, &data) == Success && data) {
+		XrmDatabase db = XrmGetStringDatabase((char *)data);
+		char * val_type;
+		XrmValue val;
+
+		if(db) {
+			if(XrmGetResource(db, "Xft.dpi", "Xft.Dpi", &val_type, &val) && val.addr) {
+				dpi = atof(val.addr);
+			}
+			XrmDestroyDatabase(db);
+		}
+		XFree(data);
+	}
+
+	if(dpi <= 0.0f) {
+		int scr = DefaultScreen(dpy);
+		int mm = DisplayWidthMM(dpy, scr);
+
+		if(mm > 0) {
+			dpi = DisplayWidth(dpy, scr) * 25.4f / mm;
+		}
+	}
+
+	// snap to quarter steps so that a slightly off screen size doesn't
+	// produce an odd font size
+	scale = floor(dpi / 96.0f * 4.0f + 0.5f) / 4.0f;
+
+	return (scale < 1.0f) ? 1.0f : scale;
+}
+
+
 static
 void
 EnableOpenGL()
@@ -200,8 +262,9 @@ CreateWindow()
 		width = desktop_w;
 		height = desktop_h;
 	} else {
-		width = WIN_INIT_WIDTH;
-		height = WIN_INIT_HEIGHT;
+		float scale = QueryScale();
+		width = WIN_INIT_WIDTH * scale;
+		height = WIN_INIT_HEIGHT * scale;
 	}
 	
 	win = XCreateWindow(dpy, root, 
@@ -236,6 +299,9 @@ CreateWindow()
 	wmDeleteMessage = XInternAtom(dpy, "WM_DELETE_WINDOW", 0);
 	XSetWMProtocols(dpy, win, &wmDeleteMessage, 1);
 	
+	// hear about Xft.dpi changes (see QueryScale)
+	XSelectInput(dpy, root, PropertyChangeMask);
+	
 	// make sure to enable OpenGL before showing window,
 	// otherwise weird window flash/artifact for a second.
 	EnableOpenGL();
@@ -282,6 +348,7 @@ int main(int argc, char *argv[])
 	App_FullscreenDel(ToggleFullscreen);
 	App_QuitRequestDel(OnQuitRequest);
 	App_UpdateTitleDel(UpdateTitle);
+	App_OnScale(QueryScale());
 	App_OnInit();
 
 	while(!quit) {
@@ -292,6 +359,11 @@ int main(int argc, char *argv[])
 			if (xev.type == ClientMessage &&
 				xev.xclient.data.l[0] == wmDeleteMessage) {
 				quit = 1;
+			} else if(xev.type == PropertyNotify) {
+				if(xev.xproperty.window == root &&
+					xev.xproperty.atom == XA_RESOURCE_MANAGER) {
+					App_OnScale(QueryScale());
+				}
 			} else if(xev.type == Expose) {
 				XWindowAttributes old_gwa = gwa;
 				XGetWindowAttributes(dpy, win, &gwa);
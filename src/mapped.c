@@ -0,0 +1,135 @@
+/*************************************************************************
+ * mapped.c -- Read-only mapped files, swapped for new ones in one go.
+ *
+ * Candlestick App: Just Write. A minimalist, cross-platform writing app.
+ * Copyright (C) 2013 Thomas Klemz
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************************/
+
+#include "mapped.h"
+
+#include <stdio.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <sys/mman.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+
+int
+Mapped_Open(mapped_t * m, const char * path, size_t min_len)
+{
+	Mapped_Close(m);
+
+#if defined(__unix__) || defined(__APPLE__)
+	{
+		struct stat st;
+		int fd = open(path, O_RDONLY);
+		void * mem;
+
+		if(fd < 0) {
+			return 0;
+		}
+
+		if(fstat(fd, &st) == -1 || st.st_size == 0 || (size_t)st.st_size < min_len) {
+			close(fd);
+			return 0;
+		}
+
+		mem = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+
+		if(mem == MAP_FAILED) {
+			return 0;
+		}
+
+		m->data = (char *)mem;
+		m->len = st.st_size;
+	}
+#elif defined(_WIN32)
+	{
+		DWORD size;
+
+		m->file = CreateFile(path, GENERIC_READ, FILE_SHARE_READ,
+			NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+		if(m->file == INVALID_HANDLE_VALUE) {
+			return 0;
+		}
+
+		size = GetFileSize(m->file, NULL);
+		m->obj = (size > 0 && size >= min_len) ?
+			CreateFileMapping(m->file, NULL, PAGE_READONLY, 0, 0, NULL) : 0;
+
+		if(!m->obj) {
+			CloseHandle(m->file);
+			return 0;
+		}
+
+		m->data = (char *)MapViewOfFile(m->obj, FILE_MAP_READ, 0, 0, 0);
+		m->len = size;
+
+		if(!m->data) {
+			CloseHandle(m->obj);
+			CloseHandle(m->file);
+			m->len = 0;
+			return 0;
+		}
+	}
+#endif
+
+	return 1;
+}
+
+void
+Mapped_Close(mapped_t * m)
+{
+	if(m->data) {
+#if defined(__unix__) || defined(__APPLE__)
+		munmap(m->data, m->len);
+#elif defined(_WIN32)
+		UnmapViewOfFile(m->data);
+		CloseHandle(m->obj);
+		CloseHandle(m->file);
+#endif
+	}
+
+	m->data = 0;
+	m->len = 0;
+}
+
+int
+Mapped_Replace(mapped_t * m, const char * path, const char * tmp_path, int written)
+{
+	int ok = written;
+
+	Mapped_Close(m);
+
+	if(ok) {
+#if defined(_WIN32)
+		remove(path);
+#endif
+		ok = (rename(tmp_path, path) == 0);
+	}
+
+	if(!ok) {
+		remove(tmp_path);
+	}
+
+	return ok;
+}
@@ -0,0 +1,69 @@
+/*************************************************************************
+ * mapped.h -- Read-only mapped files, swapped for new ones in one go.
+ *
+ * Candlestick App: Just Write. A minimalist, cross-platform writing app.
+ * Copyright (C) 2013 Thomas Klemz
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************************/
+
+#ifndef CS_MAPPED_H
+#define CS_MAPPED_H
+
+#include <stddef.h>
+
+#if defined(_WIN32)
+#  include <windows.h>
+#endif
+
+// a zeroed one is closed
+typedef struct {
+	char * data;
+	size_t len;
+#if defined(_WIN32)
+	HANDLE file;
+	HANDLE obj;
+#endif
+} mapped_t;
+
+
+/**************************************************************************
+ * Open / Close
+ *
+ * Maps the whole file read only. Returns 0 if it isn't there, can't be
+ * mapped or is shorter than min_len; what's in it is up to the caller
+ * to check.
+ **************************************************************************/
+
+int
+Mapped_Open(mapped_t * m, const char * path, size_t min_len);
+
+void
+Mapped_Close(mapped_t * m);
+
+
+/**************************************************************************
+ * Replace
+ *
+ * Closes the mapped path (it has to be let go of before it can be
+ * replaced, on Windows) and renames tmp_path over it, if written says
+ * it was written out whole; otherwise tmp_path is removed. Returns 0
+ * if path wasn't replaced. Nothing is mapped afterwards, so the caller
+ * can check the new file as it opens it.
+ **************************************************************************/
+
+int
+Mapped_Replace(mapped_t * m, const char * path, const char * tmp_path, int written);
+
+#endif
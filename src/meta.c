@@ -0,0 +1,574 @@
+/*************************************************************************
+ * meta.c -- What the open screen shows about each document.
+ *
+ * Candlestick App: Just Write. A minimalist, cross-platform writing app.
+ * Copyright (C) 2013 Thomas Klemz
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************************/
+
+#include "meta.h"
+#include "thread.h"
+#include "enc.h"
+#include "doc.h"
+#include "utf.h"
+#include "mapped.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+/**************************************************************************
+ * Metadata file
+ *
+ *   header | records | strings
+ *
+ * One fixed size record per document, sorted by name, so the open
+ * screen binary searches them straight out of the mapped file; the
+ * strings are the names and previews. Everything is in native byte
+ * order; the file is only a cache and is rebuilt if the header doesn't
+ * match.
+ **************************************************************************/
+
+#define META_MAGIC "CSMD"
+#define META_VERSION 1
+
+typedef struct {
+	char magic[4];
+	unsigned int version;
+	unsigned int num_docs;
+	unsigned int recs_off;
+	unsigned int strs_off;
+	unsigned int file_len;
+} meta_header_t;
+
+typedef struct {
+	unsigned int name;         // offsets into the strings
+	unsigned int preview;
+	unsigned int mtime_lo;
+	unsigned int mtime_hi;
+	unsigned int size_lo;
+	unsigned int size_hi;
+	unsigned int words;
+	unsigned int chars;
+	unsigned int lines;
+} meta_rec_t;
+
+static mapped_t map = {0};
+
+static meta_header_t * hdr = 0;
+static meta_rec_t * recs = 0;
+static char * strs = 0;
+
+
+static
+void
+Meta_Unmap()
+{
+	Mapped_Close(&map);
+	hdr = 0;
+}
+
+// maps the file; 0 if there is none (or it's not one of ours)
+static
+int
+Meta_Map()
+{
+	unsigned int i;
+
+	if(!Mapped_Open(&map, META_FILE, sizeof(meta_header_t))) {
+		hdr = 0;
+		return 0;
+	}
+
+	hdr = (meta_header_t *)map.data;
+	recs = (meta_rec_t *)(map.data + hdr->recs_off);
+	strs = map.data + hdr->strs_off;
+
+	// the strings end in a NUL, so any offset into them finds one
+	if(memcmp(hdr->magic, META_MAGIC, 4) || hdr->version != META_VERSION ||
+		hdr->file_len != map.len || hdr->strs_off >= map.len ||
+		hdr->recs_off + hdr->num_docs * sizeof(meta_rec_t) > hdr->strs_off ||
+		map.data[map.len - 1] != '\0') {
+		fputs("Ignoring unreadable document metadata.\n", stderr);
+		Meta_Unmap();
+		return 0;
+	}
+
+	for(i = 0; i < hdr->num_docs; ++i) {
+		if(recs[i].name >= map.len - hdr->strs_off || recs[i].preview >= map.len - hdr->strs_off) {
+			fputs("Ignoring unreadable document metadata.\n", stderr);
+			Meta_Unmap();
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static
+meta_rec_t *
+Meta_Find(char * name)
+{
+	int lo = 0;
+	int hi = hdr ? (int)hdr->num_docs : 0;
+
+	while(lo < hi) {
+		int mid = (lo + hi) / 2;
+		int cmp = strcmp(strs + recs[mid].name, name);
+
+		if(cmp == 0) {
+			return &recs[mid];
+		} else if(cmp < 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return 0;
+}
+
+
+/**************************************************************************
+ * Reading
+ *
+ * Runs on the pool's workers, one document at a time. Documents in
+ * other encodings are converted to UTF-8 first, just as when the app
+ * opens them.
+ **************************************************************************/
+
+typedef struct {
+	char * name;
+	unsigned long long mtime;  // 0 if it couldn't be read
+	unsigned long long size;
+	unsigned int words;
+	unsigned int chars;
+	unsigned int lines;
+	char preview[META_PREVIEW + 1];
+} meta_doc_t;
+
+typedef struct {
+	meta_doc_t * docs;
+	int * which;               // index into docs of each one to read
+} meta_job_t;
+
+// the sync, which the reading reports to
+static cs_job_t sync_job = {0};
+
+// the buffer isn't NUL terminated, so a sequence cut off at the end
+// is taken a byte at a time
+static
+int
+Meta_Rune(Rune * rune, const char * text, long left)
+{
+	if((unsigned char)*text < Runeself) {
+		*rune = (unsigned char)*text;
+		return 1;
+	}
+
+	if(!fullrune((char *)text, left < UTFmax ? (int)left : UTFmax)) {
+		*rune = Runeerror;
+		return 1;
+	}
+
+	return chartorune(rune, (char *)text);
+}
+
+// a word starts where a non-space follows a space (or nothing); line
+// ends aren't characters, as in the frame
+static
+void
+Meta_Count(meta_doc_t * d, const char * text, long len)
+{
+	int in_word = 0;
+	long i;
+	int n;
+	Rune rune;
+
+	d->words = 0;
+	d->chars = 0;
+	d->lines = 1;
+
+	for(i = 0; i < len; i += n) {
+		n = Meta_Rune(&rune, text + i, len - i);
+
+		if(rune == '\r' && i + 1 < len && text[i + 1] == '\n') {
+			continue;
+		}
+
+		if(rune == '\n' || rune == '\r' || rune == 0x2028 || rune == 0x2029) {
+			d->lines += 1;
+			in_word = 0;
+			continue;
+		}
+
+		d->chars += 1;
+
+		if(isspacerune(rune)) {
+			in_word = 0;
+		} else if(!in_word) {
+			in_word = 1;
+			d->words += 1;
+		}
+	}
+}
+
+// the first line with anything on it, cut to whole runes
+static
+void
+Meta_Preview(meta_doc_t * d, const char * text, long len)
+{
+	long i = 0;
+	int out = 0;
+
+	while(i < len && isspace((unsigned char)text[i])) {
+		++i;
+	}
+
+	while(i < len && text[i] != '\n' && text[i] != '\r') {
+		Rune rune;
+		int n = Meta_Rune(&rune, text + i, len - i);
+
+		if(rune == 0x2028 || rune == 0x2029 || out + n > META_PREVIEW) {
+			break;
+		}
+
+		if(rune < ' ' || (rune == Runeerror && n == 1)) {
+			d->preview[out++] = ' ';
+		} else {
+			memcpy(&d->preview[out], &text[i], n);
+			out += n;
+		}
+		i += n;
+	}
+
+	d->preview[out] = '\0';
+}
+
+static
+void
+Meta_ReadDoc(meta_doc_t * d)
+{
+	char * text;
+	long len = 0;
+	enc_t enc;
+
+	// stat first: a save after this is seen by the next sync
+	if(!Files_Stat(d->name, &d->mtime, &d->size)) {
+		d->mtime = 0;
+		return;
+	}
+
+	text = Doc_Read(d->name, &len);
+
+	if(text) {
+		text = Enc_ToUtf8(text, &len, &enc);
+	}
+
+	if(!text) {
+		d->mtime = 0;
+		return;
+	}
+
+	Meta_Count(d, text, len);
+	Meta_Preview(d, text, len);
+
+	free(text);
+}
+
+static
+void
+Meta_ReadTask(int item, int worker, void * arg)
+{
+	meta_job_t * job = (meta_job_t *)arg;
+
+	// a skipped document has no mtime, so the next sync reads it
+	if(Job_Cancelled(&sync_job)) {
+		job->docs[job->which[item]].mtime = 0;
+	} else {
+		Meta_ReadDoc(&job->docs[job->which[item]]);
+	}
+
+	Job_Step(&sync_job);
+}
+
+
+/**************************************************************************
+ * Writing
+ **************************************************************************/
+
+static
+int
+Meta_DocCmp(const void * p1, const void * p2)
+{
+	return strcmp(((meta_doc_t *)p1)->name, ((meta_doc_t *)p2)->name);
+}
+
+static
+int
+Meta_Write(meta_doc_t * docs, int num_docs)
+{
+	meta_header_t h;
+	meta_rec_t * out_recs = (meta_rec_t *)malloc((num_docs + 1) * sizeof(meta_rec_t));
+	size_t strs_len = 1;
+	char * out_strs;
+	char * s;
+	FILE * file;
+	int num = 0;
+	int ok;
+	int i;
+
+	qsort(docs, num_docs, sizeof(meta_doc_t), Meta_DocCmp);
+
+	for(i = 0; i < num_docs; ++i) {
+		strs_len += strlen(docs[i].name) + strlen(docs[i].preview) + 2;
+	}
+
+	s = out_strs = (char *)malloc(strs_len);
+
+	for(i = 0; i < num_docs; ++i) {
+		meta_doc_t * d = &docs[i];
+		meta_rec_t * r = &out_recs[num];
+
+		// what couldn't be read is tried again next time
+		if(!d->mtime) {
+			continue;
+		}
+
+		r->name = s - out_strs;
+		strcpy(s, d->name);
+		s += strlen(d->name) + 1;
+
+		r->preview = s - out_strs;
+		strcpy(s, d->preview);
+		s += strlen(d->preview) + 1;
+
+		r->mtime_lo = (unsigned int)d->mtime;
+		r->mtime_hi = (unsigned int)(d->mtime >> 32);
+		r->size_lo = (unsigned int)d->size;
+		r->size_hi = (unsigned int)(d->size >> 32);
+		r->words = d->words;
+		r->chars = d->chars;
+		r->lines = d->lines;
+		++num;
+	}
+
+	// so the mapped strings always end in a NUL
+	*s++ = '\0';
+
+	memcpy(h.magic, META_MAGIC, 4);
+	h.version = META_VERSION;
+	h.num_docs = num;
+	h.recs_off = sizeof(meta_header_t);
+	h.strs_off = h.recs_off + num * sizeof(meta_rec_t);
+	h.file_len = h.strs_off + (s - out_strs);
+
+	// write next to it and swap it in, so a crash never leaves half a file
+	file = fopen(META_TMP_FILE, "wb");
+	ok = (file != 0);
+
+	if(file) {
+		ok = fwrite(&h, sizeof(h), 1, file) == 1 &&
+			fwrite(out_recs, sizeof(meta_rec_t), num, file) == (size_t)num &&
+			fwrite(out_strs, 1, s - out_strs, file) == (size_t)(s - out_strs);
+		ok = (fclose(file) == 0) && ok;
+	}
+
+	free(out_recs);
+	free(out_strs);
+
+	return ok;
+}
+
+// swaps a freshly written file in for the mapped one (on the thread
+// that calls Meta_Get); written is what Meta_Write returned
+static
+void
+Meta_Swap(int written)
+{
+	int ok;
+
+	hdr = 0;
+
+	// the folder's listing is as current afterwards as it was before
+	Files_BeginSideWrite();
+	ok = Mapped_Replace(&map, META_FILE, META_TMP_FILE, written);
+	Files_EndSideWrite();
+
+	if(!ok) {
+		fputs("Could not write the document metadata!\n", stderr);
+	}
+
+	Meta_Map();
+}
+
+
+/**************************************************************************
+ * Sync
+ *
+ * Runs on its own thread. Only reads the mapped file, which the main
+ * thread leaves in place until the sync is done.
+ **************************************************************************/
+
+static int sync_written = 0;   // 1 written, -1 nothing changed
+static char ** sync_names = 0;
+static int sync_num = 0;
+
+static
+void
+Meta_SyncMain(cs_job_t * sync)
+{
+	meta_doc_t * docs = (meta_doc_t *)calloc(sync_num + 1, sizeof(meta_doc_t));
+	meta_job_t job;
+	int num_stale = 0;
+	int written = -1;
+	int i;
+
+	job.docs = docs;
+	job.which = (int *)malloc((sync_num + 1) * sizeof(int));
+
+	for(i = 0; i < sync_num; ++i) {
+		meta_doc_t * d = &docs[i];
+		meta_rec_t * r = Meta_Find(sync_names[i]);
+
+		d->name = sync_names[i];
+
+		if(r && Files_Stat(d->name, &d->mtime, &d->size) &&
+			d->mtime == (r->mtime_lo | ((unsigned long long)r->mtime_hi << 32)) &&
+			d->size == (r->size_lo | ((unsigned long long)r->size_hi << 32))) {
+			d->words = r->words;
+			d->chars = r->chars;
+			d->lines = r->lines;
+			strncpy(d->preview, strs + r->preview, META_PREVIEW);
+			d->preview[META_PREVIEW] = '\0';
+		} else {
+			job.which[num_stale++] = i;
+		}
+	}
+
+	Job_SetTotal(sync, num_stale);
+
+	Pool_Run(num_stale, Meta_ReadTask, &job);
+
+	// documents that went away are dropped too
+	if(num_stale > 0 || !hdr || hdr->num_docs != (unsigned int)sync_num) {
+		written = Meta_Write(docs, sync_num);
+	}
+
+	free(job.which);
+	free(docs);
+
+	sync_written = written;
+}
+
+// once the thread's done (or stopped)
+static
+void
+Meta_FinishSync()
+{
+	if(sync_written >= 0) {
+		Meta_Swap(sync_written);
+	}
+
+	Files_FreeNames(sync_names, sync_num);
+	sync_names = 0;
+	sync_num = 0;
+}
+
+int
+Meta_StartSync()
+{
+	if(Job_Running(&sync_job)) {
+		return 1;
+	}
+
+	if(!hdr) {
+		Meta_Map();
+	}
+
+	sync_names = Files_CopyNames(&sync_num);
+
+	if(!Job_Start(&sync_job, Meta_SyncMain)) {
+		fputs("Could not start the document metadata thread!\n", stderr);
+
+		Files_FreeNames(sync_names, sync_num);
+		sync_names = 0;
+		sync_num = 0;
+
+		return 0;
+	}
+
+	return 1;
+}
+
+int
+Meta_Progress(int * done, int * total)
+{
+	if(!Job_Running(&sync_job)) {
+		return 0;
+	}
+
+	if(Job_Progress(&sync_job, done, total)) {
+		return 1;
+	}
+
+	Meta_FinishSync();
+
+	return 0;
+}
+
+
+/**************************************************************************
+ * Get
+ **************************************************************************/
+
+int
+Meta_Get(char * name, meta_t * meta)
+{
+	meta_rec_t * r;
+
+	// the sync thread reads the map, so it's only ever mapped from here
+	// while there's no sync
+	if(!hdr && !Job_Running(&sync_job)) {
+		Meta_Map();
+	}
+
+	if(!hdr || !(r = Meta_Find(name))) {
+		return 0;
+	}
+
+	meta->mtime = r->mtime_lo | ((unsigned long long)r->mtime_hi << 32);
+	meta->size = r->size_lo | ((unsigned long long)r->size_hi << 32);
+	meta->words = r->words;
+	meta->chars = r->chars;
+	meta->lines = r->lines;
+	meta->preview = strs + r->preview;
+
+	return 1;
+}
+
+void
+Meta_Cleanup()
+{
+	if(Job_Running(&sync_job)) {
+		Job_Stop(&sync_job);
+		Meta_FinishSync();
+	}
+
+	Job_Destroy(&sync_job);
+
+	Meta_Unmap();
+}
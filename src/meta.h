@@ -0,0 +1,84 @@
+/*************************************************************************
+ * meta.h -- What the open screen shows about each document.
+ *
+ * Candlestick App: Just Write. A minimalist, cross-platform writing app.
+ * Copyright (C) 2013 Thomas Klemz
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************************/
+
+#ifndef CS_META_H
+#define CS_META_H
+
+#include "files.h"
+
+// kept next to the documents (not a .txt, so never listed); it's
+// written outside the folder and only renamed into it
+#define META_FILE DOCS_FOLDER ".meta"
+#define META_TMP_FILE DOCS_FOLDER "../.meta.tmp"
+// the most bytes of a document's first line that are kept
+#define META_PREVIEW 48
+
+typedef struct {
+	unsigned long long mtime;
+	unsigned long long size;
+	unsigned int words;        // counted as the typing screen does
+	unsigned int chars;
+	unsigned int lines;
+	const char * preview;      // the first line with anything on it
+} meta_t;
+
+
+/**************************************************************************
+ * StartSync
+ *
+ * Starts bringing the metadata up to date with the documents folder in
+ * the background: only the documents that are new or changed (by mtime
+ * and size) since they were looked at are read again, on every core.
+ * Meta_Get keeps answering from the old file until it's done. Returns
+ * 0 if it couldn't be started.
+ **************************************************************************/
+
+int
+Meta_StartSync();
+
+
+/**************************************************************************
+ * Progress
+ *
+ * While a sync runs, returns 1 with the number of documents read so far
+ * and how many there are to read. Once it's done, the first call puts
+ * the new file in place (any earlier Meta_Get preview goes stale) and
+ * returns 0. Call it from the thread that calls Meta_Get.
+ **************************************************************************/
+
+int
+Meta_Progress(int * done, int * total);
+
+
+/**************************************************************************
+ * Get
+ *
+ * Fills in what's known about a document (name with extension) without
+ * touching it; 0 if it hasn't been looked at yet. The preview belongs
+ * to this module and stays valid until the next sync finishes.
+ **************************************************************************/
+
+int
+Meta_Get(char * name, meta_t * meta);
+
+void
+Meta_Cleanup();
+
+#endif
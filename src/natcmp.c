@@ -14,26 +14,37 @@
 int
 natstrcmp(const char *s1, const char *s2)
 {
+	const unsigned char *u1 = (const unsigned char *)s1;
+	const unsigned char *u2 = (const unsigned char *)s2;
+
 	for (;;) {
-		if (*s2 == '\0')
-			return *s1 != '\0';
-		else if (*s1 == '\0')
-			return 1;
-		else if (!(isdigit(*s1) && isdigit(*s2))) {
-			if (tolower(*s1) != tolower(*s2))
-				return (int)*s1 - (int)*s2;
+		if (*u2 == '\0')
+			return *u1 != '\0';
+		else if (*u1 == '\0')
+			return -1;
+		else if (!(isdigit(*u1) && isdigit(*u2))) {
+			if (tolower(*u1) != tolower(*u2))
+				return tolower(*u1) - tolower(*u2);
 			else
-				(++s1, ++s2);
+				(++u1, ++u2);
 		} else {
-			char *lim1, *lim2;
-			unsigned long n1 = strtoul(s1, &lim1, 10);
-			unsigned long n2 = strtoul(s2, &lim2, 10);
-			if (n1 > n2)
-				return 1;
-			else if (n1 < n2)
-				return -1;
-			s1 = lim1;
-			s2 = lim2;
+			/* compare the runs by value without converting them, so
+			 * any length works (and it matches natkey below) */
+			const unsigned char *e1, *e2;
+			while (*u1 == '0')
+				++u1;
+			while (*u2 == '0')
+				++u2;
+			for (e1 = u1; isdigit(*e1); ++e1)
+				;
+			for (e2 = u2; isdigit(*e2); ++e2)
+				;
+			if (e1 - u1 != e2 - u2)
+				return (e1 - u1 > e2 - u2) ? 1 : -1;
+			for (; u1 < e1; ++u1, ++u2)
+				if (*u1 != *u2)
+					return (int)*u1 - (int)*u2;
+			u2 = e2;
 		}
 	}
 }
@@ -47,3 +58,41 @@ natcmp(const void *p1, const void *p2)
 	const char * const *ps2 = p2;
 	return natstrcmp(*ps1, *ps2);
 }
+
+/*
+ * Writes a key for s such that strcmp() on two keys orders them like
+ * natstrcmp() on the strings, so a sort parses every name once instead
+ * of on every comparison. Letters are case folded; a digit run becomes
+ * '0' (which sorts against any other character like a digit would), a
+ * length byte and the digits without leading zeros. key needs room for
+ * NATKEY_SIZE(strlen(s)) bytes. Returns the key length.
+ */
+
+int
+natkey(const char *s, char *key)
+{
+	const unsigned char *u = (const unsigned char *)s;
+	unsigned char *k = (unsigned char *)key;
+
+	while (*u) {
+		if (!isdigit(*u)) {
+			*k++ = (unsigned char)tolower(*u++);
+		} else {
+			const unsigned char *end;
+			int n;
+			while (*u == '0')
+				++u;
+			for (end = u; isdigit(*end); ++end)
+				;
+			n = (int)(end - u);
+			*k++ = '0';
+			/* runs past 254 digits all tie on length; never in practice */
+			*k++ = (unsigned char)((n < 254 ? n : 254) + 1);
+			while (u < end)
+				*k++ = *u++;
+		}
+	}
+	*k = '\0';
+
+	return (int)(k - (unsigned char *)key);
+}
@@ -18,5 +18,11 @@ natstrcmp(const char *s1, const char *s2);
 int
 natcmp(const void *p1, const void *p2);
 
+// room for the key of a string of len bytes (a digit can take 3)
+#define NATKEY_SIZE(len) (3 * (len) + 1)
+
+int
+natkey(const char *s, char *key);
+
 
 #endif
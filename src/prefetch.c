@@ -0,0 +1,295 @@
+/*************************************************************************
+ * prefetch.c -- Reads the document the open screen rests on ahead of time.
+ *
+ * Candlestick App: Just Write. A minimalist, cross-platform writing app.
+ * Copyright (C) 2013 Thomas Klemz
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************************/
+
+#include "prefetch.h"
+#include "files.h"
+#include "thread.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+/* One thread at a time, started by a new hint. It naps PREFETCH_DELAY
+ * and reads the hinted document if the hint didn't move meanwhile, and
+ * ends once there's nothing left to read (the next hint starts another).
+ * Everything below is guarded by the lock.
+ */
+
+static cs_mutex_t lock;
+static cs_cond_t loaded;        // broadcast once loading is done with
+static int lock_ready = 0;
+static cs_thread_t thread;
+static int started = 0;         // there's a thread to join
+static int running = 0;
+static int quit = 0;
+
+static char * hint = 0;
+static unsigned int hint_gen = 0;
+static unsigned int read_gen = 0;   // the hint last read (or tried)
+static prefetch_load_t loader = 0;
+static char * loading = 0;      // what the thread is reading now
+
+static char * ready_name = 0;
+static Frame * ready = 0;
+static unsigned long long ready_mtime = 0;
+static unsigned long long ready_size = 0;
+
+
+static
+char *
+Prefetch_Copy(char * s)
+{
+	char * copy = (char *)malloc(strlen(s) + 1);
+
+	strcpy(copy, s);
+
+	return copy;
+}
+
+// the OS starts reading the whole file in while it's being loaded (a
+// packed one is read a block at a time as it's unpacked)
+static
+void
+Prefetch_Advise(char * name)
+{
+#if defined(__unix__) && defined(POSIX_FADV_WILLNEED)
+	char * path = Files_GetAbsPath(name);
+	int fd = open(path, O_RDONLY);
+
+	if(fd >= 0) {
+		posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+		close(fd);
+	}
+
+	free(path);
+#else
+	(void)name;
+#endif
+}
+
+static
+void
+Prefetch_Main(void * arg)
+{
+	for(;;) {
+		unsigned int gen;
+		char * name = 0;
+		prefetch_load_t load = 0;
+
+		Mutex_Lock(&lock);
+		gen = hint_gen;
+		Mutex_Unlock(&lock);
+
+		Thread_Sleep(PREFETCH_DELAY);
+
+		Mutex_Lock(&lock);
+
+		if(quit || !hint || read_gen == hint_gen ||
+			(ready_name && !strcmp(ready_name, hint))) {
+			running = 0;
+			Mutex_Unlock(&lock);
+			return;
+		}
+
+		// still moving, so nap again
+		if(gen == hint_gen) {
+			name = Prefetch_Copy(hint);
+			load = loader;
+			loading = name;
+		}
+
+		Mutex_Unlock(&lock);
+
+		if(name) {
+			unsigned long long mtime = 0;
+			unsigned long long size = 0;
+			Frame * frm;
+
+			Files_Stat(name, &mtime, &size);
+			Prefetch_Advise(name);
+			frm = load(name);
+
+			Mutex_Lock(&lock);
+
+			if(ready) {
+				Frame_Destroy(ready);
+			}
+			free(ready_name);
+
+			ready = frm;
+			ready_name = frm ? name : 0;
+			ready_mtime = mtime;
+			ready_size = size;
+			loading = 0;
+			read_gen = gen;
+
+			if(!frm) {
+				free(name);
+			}
+
+			Cond_Broadcast(&loaded);
+			Mutex_Unlock(&lock);
+		}
+	}
+}
+
+void
+Prefetch_Hint(char * name, prefetch_load_t load)
+{
+	int changed;
+	int start;
+
+	if(!lock_ready) {
+		Mutex_Init(&lock);
+		Cond_Init(&loaded);
+		lock_ready = 1;
+	}
+
+	Mutex_Lock(&lock);
+
+	changed = name ? (!hint || strcmp(hint, name)) : (hint != 0);
+
+	if(changed) {
+		free(hint);
+		hint = name ? Prefetch_Copy(name) : 0;
+		hint_gen += 1;
+		loader = load;
+	}
+
+	start = changed && name && !running;
+	running = running || start;
+
+	Mutex_Unlock(&lock);
+
+	if(start) {
+		// the last one has finished (or is about to)
+		if(started) {
+			Thread_Join(&thread);
+		}
+
+		started = Thread_Start(&thread, Prefetch_Main, 0);
+
+		if(!started) {
+			Mutex_Lock(&lock);
+			running = 0;
+			Mutex_Unlock(&lock);
+		}
+	}
+}
+
+Frame*
+Prefetch_Take(char * name, unsigned long long mtime, unsigned long long size)
+{
+	Frame * frm = 0;
+
+	if(!lock_ready) {
+		return 0;
+	}
+
+	Mutex_Lock(&lock);
+
+	// it's going to be read anyway, and it's further along there
+	while(loading && !strcmp(loading, name)) {
+		Cond_Wait(&loaded, &lock);
+	}
+
+	if(ready && !strcmp(ready_name, name)) {
+		if(ready_mtime == mtime && ready_size == size) {
+			frm = ready;
+		} else {
+			Frame_Destroy(ready);
+		}
+
+		ready = 0;
+		free(ready_name);
+		ready_name = 0;
+	}
+
+	// and it isn't read again
+	if(hint && !strcmp(hint, name)) {
+		free(hint);
+		hint = 0;
+		hint_gen += 1;
+	}
+
+	Mutex_Unlock(&lock);
+
+	return frm;
+}
+
+Frame*
+Prefetch_Release(char ** name, unsigned long long * mtime, unsigned long long * size)
+{
+	Frame * frm;
+
+	if(!lock_ready) {
+		return 0;
+	}
+
+	Mutex_Lock(&lock);
+
+	frm = ready;
+	*name = ready_name;
+	*mtime = ready_mtime;
+	*size = ready_size;
+
+	ready = 0;
+	ready_name = 0;
+
+	Mutex_Unlock(&lock);
+
+	return frm;
+}
+
+void
+Prefetch_Cleanup()
+{
+	if(!lock_ready) {
+		return;
+	}
+
+	Mutex_Lock(&lock);
+	quit = 1;
+	Mutex_Unlock(&lock);
+
+	if(started) {
+		Thread_Join(&thread);
+		started = 0;
+	}
+
+	if(ready) {
+		Frame_Destroy(ready);
+		ready = 0;
+	}
+	free(ready_name);
+	ready_name = 0;
+	free(hint);
+	hint = 0;
+	running = 0;
+	quit = 0;
+
+	Cond_Destroy(&loaded);
+	Mutex_Destroy(&lock);
+	lock_ready = 0;
+}
@@ -0,0 +1,74 @@
+/*************************************************************************
+ * prefetch.h -- Reads the document the open screen rests on ahead of time.
+ *
+ * Candlestick App: Just Write. A minimalist, cross-platform writing app.
+ * Copyright (C) 2013 Thomas Klemz
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************************/
+
+#ifndef CS_PREFETCH_H
+#define CS_PREFETCH_H
+
+#include "frame.h"
+
+// how long the highlight has to stay on a document before it's read (ms)
+#define PREFETCH_DELAY 200
+
+// reads a document (name with extension) into a new frame, or returns 0;
+// it's called on another thread, so it mustn't touch anything shared
+typedef Frame* (*prefetch_load_t)(char * name);
+
+
+/**************************************************************************
+ * Hint
+ *
+ * Says which document is highlighted (0 for none). Once it's stayed
+ * that way for PREFETCH_DELAY, a thread asks the OS to start reading
+ * the file in and loads it into a frame, so it's ready if it's opened.
+ * Cheap to call on every render.
+ **************************************************************************/
+
+void
+Prefetch_Hint(char * name, prefetch_load_t load);
+
+
+/**************************************************************************
+ * Take
+ *
+ * Returns the document's frame, now the caller's, if it was read ahead
+ * from a file with this mtime and size (see Files_Stat); waits for it
+ * if it's being read right now. 0 if it has to be read after all.
+ **************************************************************************/
+
+Frame*
+Prefetch_Take(char * name, unsigned long long mtime, unsigned long long size);
+
+
+/**************************************************************************
+ * Release
+ *
+ * Returns the frame read ahead but never taken, now the caller's along
+ * with its name, and the mtime and size its file had; 0 if there's
+ * none. For once the highlight's gone, so it doesn't sit here outside
+ * anything's budget.
+ **************************************************************************/
+
+Frame*
+Prefetch_Release(char ** name, unsigned long long * mtime, unsigned long long * size);
+
+void
+Prefetch_Cleanup();
+
+#endif
@@ -0,0 +1,1209 @@
+/*************************************************************************
+ * search.c -- Full-text search over the documents folder.
+ *
+ * Candlestick App: Just Write. A minimalist, cross-platform writing app.
+ * Copyright (C) 2013 Thomas Klemz
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************************/
+
+#include "search.h"
+#include "thread.h"
+#include "enc.h"
+#include "doc.h"
+#include "mapped.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/**************************************************************************
+ * Index file
+ *
+ *   header | docs | terms | strings | postings
+ *
+ * Docs and terms are fixed size records, and the terms are sorted, so
+ * a query binary searches them straight out of the mapped file. Each
+ * term's postings are (doc, count) pairs in doc order, written as
+ * varints with the doc as a delta from the one before, so a word found
+ * in most documents costs about two bytes per document. Everything is
+ * in native byte order; the file is only a cache and is rebuilt if the
+ * header doesn't match.
+ **************************************************************************/
+
+#define INDEX_MAGIC "CSIX"
+#define INDEX_VERSION 1
+
+// longer words are cut (they still match on their first TERM_MAX bytes)
+#define TERM_MAX 32
+#define QUERY_MAX_TERMS 16
+// how many words the last, still being typed, query word may expand to
+#define PREFIX_MAX_TERMS 64
+
+typedef struct {
+	char magic[4];
+	unsigned int version;
+	unsigned int num_docs;
+	unsigned int num_terms;
+	unsigned int docs_off;
+	unsigned int terms_off;
+	unsigned int strs_off;
+	unsigned int posts_off;
+	unsigned int file_len;
+	unsigned int total_tokens; // for the average document length
+} index_header_t;
+
+typedef struct {
+	unsigned int name;         // offset into the strings
+	unsigned int tokens;
+	unsigned int mtime_lo;
+	unsigned int mtime_hi;
+	unsigned int size_lo;
+	unsigned int size_hi;
+} index_doc_t;
+
+typedef struct {
+	unsigned int str;          // offset into the strings
+	unsigned int df;           // number of documents with the term
+	unsigned int post;         // offset into the postings
+	unsigned int post_len;
+} index_term_t;
+
+static mapped_t map = {0};
+
+static index_header_t * hdr = 0;
+static index_doc_t * docs = 0;
+static index_term_t * terms = 0;
+static char * strs = 0;
+static unsigned char * posts = 0;
+
+// the last query's results; the names point into the map
+static files_t hits = {0};
+
+
+static
+unsigned char *
+Search_PutVarint(unsigned char * p, unsigned int v)
+{
+	while(v >= 0x80) {
+		*p++ = (unsigned char)(v | 0x80);
+		v >>= 7;
+	}
+	*p++ = (unsigned char)v;
+
+	return p;
+}
+
+// never reads past end, even if the list there was cut short
+static
+const unsigned char *
+Search_GetVarint(const unsigned char * p, const unsigned char * end, unsigned int * v)
+{
+	unsigned int val = 0;
+	int shift = 0;
+
+	while(p < end && (*p & 0x80) && shift < 32) {
+		val |= (unsigned int)(*p++ & 0x7f) << shift;
+		shift += 7;
+	}
+	if(p < end && shift < 32) {
+		val |= (unsigned int)*p++ << shift;
+	}
+	*v = val;
+
+	return p;
+}
+
+
+static
+void
+Search_Unmap()
+{
+	Mapped_Close(&map);
+	hdr = 0;
+}
+
+// every name and term is a string in the strings (which end in a NUL)
+// and every posting list is in the postings, so a damaged index that
+// got past the header never has anything read from outside the map
+static
+int
+Search_CheckEntries()
+{
+	size_t strs_len = hdr->posts_off - hdr->strs_off;
+	size_t posts_len = map.len - hdr->posts_off;
+	unsigned int i;
+
+	if(strs_len > 0 && strs[strs_len - 1] != '\0') {
+		return 0;
+	}
+
+	for(i = 0; i < hdr->num_docs; ++i) {
+		if(docs[i].name >= strs_len) {
+			return 0;
+		}
+	}
+
+	for(i = 0; i < hdr->num_terms; ++i) {
+		if(terms[i].str >= strs_len || terms[i].post > posts_len ||
+			terms[i].post_len > posts_len - terms[i].post) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+// maps the index file; 0 if there is none (or it's not one of ours)
+static
+int
+Search_Map()
+{
+	if(!Mapped_Open(&map, SEARCH_INDEX_FILE, sizeof(index_header_t))) {
+		hdr = 0;
+		return 0;
+	}
+
+	hdr = (index_header_t *)map.data;
+
+	if(memcmp(hdr->magic, INDEX_MAGIC, 4) || hdr->version != INDEX_VERSION ||
+		hdr->file_len != map.len || hdr->posts_off > map.len ||
+		hdr->docs_off + hdr->num_docs * sizeof(index_doc_t) > hdr->terms_off ||
+		hdr->terms_off + hdr->num_terms * sizeof(index_term_t) > hdr->strs_off ||
+		hdr->strs_off > hdr->posts_off) {
+		fputs("Ignoring unreadable search index.\n", stderr);
+		Search_Unmap();
+		return 0;
+	}
+
+	docs = (index_doc_t *)(map.data + hdr->docs_off);
+	terms = (index_term_t *)(map.data + hdr->terms_off);
+	strs = map.data + hdr->strs_off;
+	posts = (unsigned char *)(map.data + hdr->posts_off);
+
+	if(!Search_CheckEntries()) {
+		fputs("Ignoring unreadable search index.\n", stderr);
+		Search_Unmap();
+		return 0;
+	}
+
+	return 1;
+}
+
+
+/**************************************************************************
+ * Tokens
+ *
+ * A word is a run of ASCII letters and digits, or of any non-ASCII
+ * bytes (so UTF-8 words stay whole); ASCII is lowercased.
+ **************************************************************************/
+
+#define IS_WORD(c) (((c) >= 'a' && (c) <= 'z') || ((c) >= 'A' && (c) <= 'Z') || \
+	((c) >= '0' && (c) <= '9') || (c) >= 0x80)
+
+// copies the next word from *p (up to end) into tok; 0 at the end
+static
+int
+Search_NextToken(const unsigned char ** p, const unsigned char * end, char * tok)
+{
+	const unsigned char * c = *p;
+	int len = 0;
+
+	while(c < end && !IS_WORD(*c)) {
+		++c;
+	}
+
+	while(c < end && IS_WORD(*c)) {
+		if(len < TERM_MAX) {
+			tok[len++] = (*c >= 'A' && *c <= 'Z') ? *c + ('a' - 'A') : *c;
+		}
+		++c;
+	}
+
+	tok[len] = '\0';
+	*p = c;
+
+	return len;
+}
+
+
+/**************************************************************************
+ * Builder
+ *
+ * The index is rebuilt in memory and written out whole: postings of
+ * documents that didn't change are carried over from the old file
+ * (decoded and renumbered), and only new or changed documents are read
+ * and tokenized. Kept documents keep their relative order and new ones
+ * go last, so every posting list stays in doc order without sorting.
+ *
+ * New documents are read and tokenized on every core, each into a
+ * compact word list of its own, and those are merged into the builder
+ * in doc order afterwards on the thread doing the build.
+ **************************************************************************/
+
+typedef struct {
+	char * term;
+	unsigned int * post;       // doc, count pairs
+	int len;                   // pairs
+	int cap;
+} build_term_t;
+
+typedef struct {
+	char * name;
+	unsigned int tokens;
+	unsigned long long mtime;
+	unsigned long long size;
+} build_doc_t;
+
+typedef struct {
+	build_term_t * terms;
+	int num_terms;
+	int terms_cap;
+	int * slots;               // open addressing, term index + 1
+	int num_slots;
+	build_doc_t * docs;
+	int num_docs;
+	int docs_cap;
+	unsigned int total_tokens;
+} builder_t;
+
+static
+unsigned int
+Search_Hash(const char * s)
+{
+	unsigned int h = 2166136261u;
+
+	while(*s) {
+		h = (h ^ (unsigned char)*s++) * 16777619u;
+	}
+
+	return h;
+}
+
+static
+build_term_t *
+Build_Term(builder_t * b, const char * term)
+{
+	unsigned int i;
+	build_term_t * t;
+
+	// keep the table at most half full
+	if(2 * (b->num_terms + 1) > b->num_slots) {
+		int n;
+
+		free(b->slots);
+		b->num_slots = b->num_slots ? b->num_slots * 2 : 4096;
+		b->slots = (int *)calloc(b->num_slots, sizeof(int));
+
+		for(n = 0; n < b->num_terms; ++n) {
+			i = Search_Hash(b->terms[n].term) & (b->num_slots - 1);
+			while(b->slots[i]) {
+				i = (i + 1) & (b->num_slots - 1);
+			}
+			b->slots[i] = n + 1;
+		}
+	}
+
+	i = Search_Hash(term) & (b->num_slots - 1);
+
+	while(b->slots[i]) {
+		t = &b->terms[b->slots[i] - 1];
+		if(!strcmp(t->term, term)) {
+			return t;
+		}
+		i = (i + 1) & (b->num_slots - 1);
+	}
+
+	if(b->num_terms == b->terms_cap) {
+		b->terms_cap = b->terms_cap ? b->terms_cap * 2 : 1024;
+		b->terms = (build_term_t *)realloc(b->terms, b->terms_cap * sizeof(build_term_t));
+	}
+
+	t = &b->terms[b->num_terms];
+	t->term = (char *)malloc(strlen(term) + 1);
+	strcpy(t->term, term);
+	t->post = 0;
+	t->len = 0;
+	t->cap = 0;
+
+	b->slots[i] = ++b->num_terms;
+
+	return t;
+}
+
+static
+void
+Build_Posting(build_term_t * t, unsigned int doc, unsigned int count)
+{
+	if(t->len > 0 && t->post[2 * (t->len - 1)] == doc) {
+		t->post[2 * (t->len - 1) + 1] += count;
+		return;
+	}
+
+	if(t->len == t->cap) {
+		t->cap = t->cap ? t->cap * 2 : 4;
+		t->post = (unsigned int *)realloc(t->post, 2 * t->cap * sizeof(unsigned int));
+	}
+
+	t->post[2 * t->len] = doc;
+	t->post[2 * t->len + 1] = count;
+	++t->len;
+}
+
+static
+build_doc_t *
+Build_Doc(builder_t * b, const char * name)
+{
+	build_doc_t * d;
+
+	if(b->num_docs == b->docs_cap) {
+		b->docs_cap = b->docs_cap ? b->docs_cap * 2 : 256;
+		b->docs = (build_doc_t *)realloc(b->docs, b->docs_cap * sizeof(build_doc_t));
+	}
+
+	d = &b->docs[b->num_docs++];
+	d->name = (char *)malloc(strlen(name) + 1);
+	strcpy(d->name, name);
+	d->tokens = 0;
+	d->mtime = 0;
+	d->size = 0;
+
+	return d;
+}
+
+static
+void
+Build_Destroy(builder_t * b)
+{
+	int i;
+
+	for(i = 0; i < b->num_terms; ++i) {
+		free(b->terms[i].term);
+		free(b->terms[i].post);
+	}
+
+	for(i = 0; i < b->num_docs; ++i) {
+		free(b->docs[i].name);
+	}
+
+	free(b->terms);
+	free(b->slots);
+	free(b->docs);
+}
+
+// empties b for the next document, keeping its memory where that's cheap
+static
+void
+Build_Clear(builder_t * b)
+{
+	int i;
+
+	// a small document only zeroes its own slots, all found (into the
+	// no longer needed cap) before any is cleared so no probe breaks
+	if(8 * b->num_terms < b->num_slots) {
+		for(i = 0; i < b->num_terms; ++i) {
+			unsigned int n = Search_Hash(b->terms[i].term) & (b->num_slots - 1);
+
+			while(b->slots[n] != i + 1) {
+				n = (n + 1) & (b->num_slots - 1);
+			}
+			b->terms[i].cap = (int)n;
+		}
+
+		for(i = 0; i < b->num_terms; ++i) {
+			b->slots[b->terms[i].cap] = 0;
+		}
+	} else if(b->slots) {
+		memset(b->slots, 0, b->num_slots * sizeof(int));
+	}
+
+	for(i = 0; i < b->num_terms; ++i) {
+		free(b->terms[i].term);
+		free(b->terms[i].post);
+	}
+
+	b->num_terms = 0;
+	b->total_tokens = 0;
+}
+
+
+/**************************************************************************
+ * Reading
+ *
+ * Runs on the pool's workers: every worker has a scratch builder to
+ * count a document's words in, which is then flattened into the
+ * document's read_doc_t. Documents in other encodings are converted
+ * to UTF-8 first, just as when the app opens them.
+ **************************************************************************/
+
+typedef struct {
+	char * words;              // num_words NUL terminated words
+	unsigned int * counts;
+	int num_words;
+	unsigned int tokens;
+	unsigned long long mtime;
+	unsigned long long size;
+} read_doc_t;
+
+typedef struct {
+	char ** names;
+	int * which;               // index into names of each document to read
+	read_doc_t * out;
+	builder_t * scratch;       // one per worker
+	cs_job_t * job;            // what's reported to
+} read_job_t;
+
+static
+void
+Search_ReadDoc(char * name, read_doc_t * out, builder_t * b)
+{
+	char tok[TERM_MAX + 1];
+	char * text;
+	long len = 0;
+	enc_t enc;
+	size_t words_len = 0;
+	char * w;
+	int i;
+
+	memset(out, 0, sizeof(read_doc_t));
+
+	// stat first: a save after this is seen by the next sync
+	if(!Files_Stat(name, &out->mtime, &out->size)) {
+		return;
+	}
+
+	text = Doc_Read(name, &len);
+
+	if(!text) {
+		out->mtime = 0;
+		return;
+	}
+
+	text = Enc_ToUtf8(text, &len, &enc);
+
+	if(text) {
+		const unsigned char * p = (const unsigned char *)text;
+
+		while(Search_NextToken(&p, (const unsigned char *)text + len, tok)) {
+			Build_Posting(Build_Term(b, tok), 0, 1);
+			++out->tokens;
+		}
+	}
+
+	free(text);
+
+	for(i = 0; i < b->num_terms; ++i) {
+		words_len += strlen(b->terms[i].term) + 1;
+	}
+
+	out->num_words = b->num_terms;
+	out->words = w = (char *)malloc(words_len + 1);
+	out->counts = (unsigned int *)malloc((b->num_terms + 1) * sizeof(unsigned int));
+
+	for(i = 0; i < b->num_terms; ++i) {
+		strcpy(w, b->terms[i].term);
+		w += strlen(w) + 1;
+		out->counts[i] = b->terms[i].post[1];
+	}
+
+	Build_Clear(b);
+}
+
+static
+void
+Search_ReadTask(int item, int worker, void * arg)
+{
+	read_job_t * job = (read_job_t *)arg;
+
+	// a skipped document has no mtime, so the next sync reads it
+	if(Job_Cancelled(job->job)) {
+		memset(&job->out[item], 0, sizeof(read_doc_t));
+	} else {
+		Search_ReadDoc(job->names[job->which[item]], &job->out[item], &job->scratch[worker]);
+	}
+
+	Job_Step(job->job);
+}
+
+// reads the names marked fresh into the builder as its newest docs,
+// reporting to progress
+static
+void
+Build_ReadAll(builder_t * b, char ** names, char * fresh, int num_names, cs_job_t * progress)
+{
+	read_job_t job;
+	int num = 0;
+	int workers;
+	int i;
+
+	job.names = names;
+	job.job = progress;
+	job.which = (int *)malloc((num_names + 1) * sizeof(int));
+
+	for(i = 0; i < num_names; ++i) {
+		if(fresh[i]) {
+			job.which[num++] = i;
+		}
+	}
+
+	Job_SetTotal(progress, num);
+
+	workers = Pool_Workers(num);
+	job.out = (read_doc_t *)malloc((num + 1) * sizeof(read_doc_t));
+	job.scratch = (builder_t *)calloc(workers, sizeof(builder_t));
+
+	Pool_Run(num, Search_ReadTask, &job);
+
+	for(i = 0; i < num; ++i) {
+		read_doc_t * r = &job.out[i];
+		build_doc_t * d = Build_Doc(b, names[job.which[i]]);
+		unsigned int doc = b->num_docs - 1;
+		const char * w = r->words;
+		int n;
+
+		d->tokens = r->tokens;
+		d->mtime = r->mtime;
+		d->size = r->size;
+		b->total_tokens += r->tokens;
+
+		for(n = 0; n < r->num_words; ++n) {
+			Build_Posting(Build_Term(b, w), doc, r->counts[n]);
+			w += strlen(w) + 1;
+		}
+
+		free(r->words);
+		free(r->counts);
+	}
+
+	for(i = 0; i < workers; ++i) {
+		Build_Destroy(&job.scratch[i]);
+	}
+
+	free(job.scratch);
+	free(job.out);
+	free(job.which);
+}
+
+static builder_t * sort_builder = 0;
+
+static
+int
+Search_TermCmp(const void * p1, const void * p2)
+{
+	return strcmp(sort_builder->terms[*(const int *)p1].term,
+		sort_builder->terms[*(const int *)p2].term);
+}
+
+static
+int
+Build_Write(builder_t * b)
+{
+	index_header_t h;
+	int * order = (int *)malloc((b->num_terms + 1) * sizeof(int));
+	index_doc_t * out_docs = (index_doc_t *)malloc((b->num_docs + 1) * sizeof(index_doc_t));
+	index_term_t * out_terms = (index_term_t *)malloc((b->num_terms + 1) * sizeof(index_term_t));
+	size_t strs_len = 0;
+	size_t posts_len = 0;
+	char * out_strs;
+	unsigned char * out_posts;
+	char * s;
+	unsigned char * p;
+	FILE * file;
+	int ok;
+	int i;
+
+	for(i = 0; i < b->num_terms; ++i) {
+		order[i] = i;
+		strs_len += strlen(b->terms[i].term) + 1;
+		// two varints of at most 5 bytes per posting
+		posts_len += 10 * b->terms[i].len;
+	}
+
+	for(i = 0; i < b->num_docs; ++i) {
+		strs_len += strlen(b->docs[i].name) + 1;
+	}
+
+	sort_builder = b;
+	qsort(order, b->num_terms, sizeof(int), Search_TermCmp);
+
+	s = out_strs = (char *)malloc(strs_len + 1);
+	p = out_posts = (unsigned char *)malloc(posts_len + 1);
+
+	for(i = 0; i < b->num_docs; ++i) {
+		build_doc_t * d = &b->docs[i];
+
+		out_docs[i].name = s - out_strs;
+		out_docs[i].tokens = d->tokens;
+		out_docs[i].mtime_lo = (unsigned int)d->mtime;
+		out_docs[i].mtime_hi = (unsigned int)(d->mtime >> 32);
+		out_docs[i].size_lo = (unsigned int)d->size;
+		out_docs[i].size_hi = (unsigned int)(d->size >> 32);
+
+		strcpy(s, d->name);
+		s += strlen(d->name) + 1;
+	}
+
+	for(i = 0; i < b->num_terms; ++i) {
+		build_term_t * t = &b->terms[order[i]];
+		unsigned int prev = 0;
+		int n;
+
+		out_terms[i].str = s - out_strs;
+		out_terms[i].df = t->len;
+		out_terms[i].post = p - out_posts;
+
+		for(n = 0; n < t->len; ++n) {
+			p = Search_PutVarint(p, t->post[2 * n] - prev);
+			p = Search_PutVarint(p, t->post[2 * n + 1]);
+			prev = t->post[2 * n];
+		}
+
+		out_terms[i].post_len = (p - out_posts) - out_terms[i].post;
+
+		strcpy(s, t->term);
+		s += strlen(t->term) + 1;
+	}
+
+	memcpy(h.magic, INDEX_MAGIC, 4);
+	h.version = INDEX_VERSION;
+	h.num_docs = b->num_docs;
+	h.num_terms = b->num_terms;
+	h.docs_off = sizeof(index_header_t);
+	h.terms_off = h.docs_off + b->num_docs * sizeof(index_doc_t);
+	h.strs_off = h.terms_off + b->num_terms * sizeof(index_term_t);
+	h.posts_off = h.strs_off + (s - out_strs);
+	h.file_len = h.posts_off + (p - out_posts);
+	h.total_tokens = b->total_tokens;
+
+	// write next to it and swap it in, so a crash never leaves half an index
+	file = fopen(SEARCH_INDEX_FILE ".tmp", "wb");
+	ok = (file != 0);
+
+	if(file) {
+		ok = fwrite(&h, sizeof(h), 1, file) == 1 &&
+			fwrite(out_docs, sizeof(index_doc_t), b->num_docs, file) == (size_t)b->num_docs &&
+			fwrite(out_terms, sizeof(index_term_t), b->num_terms, file) == (size_t)b->num_terms &&
+			fwrite(out_strs, 1, s - out_strs, file) == (size_t)(s - out_strs) &&
+			fwrite(out_posts, 1, p - out_posts, file) == (size_t)(p - out_posts);
+		ok = (fclose(file) == 0) && ok;
+	}
+
+	free(order);
+	free(out_docs);
+	free(out_terms);
+	free(out_strs);
+	free(out_posts);
+
+	return ok;
+}
+
+// swaps a freshly written index in for the mapped one (on the thread
+// that queries); written is what Build_Write returned
+static
+int
+Search_Swap(int written)
+{
+	int ok = Mapped_Replace(&map, SEARCH_INDEX_FILE, SEARCH_INDEX_FILE ".tmp", written);
+
+	// the hits pointed into the old one
+	hdr = 0;
+	hits.len = 0;
+
+	if(!ok) {
+		fputs("Could not write the search index!\n", stderr);
+	}
+
+	Search_Map();
+
+	return ok;
+}
+
+static
+int
+Search_DocCmp(const void * p1, const void * p2)
+{
+	return strcmp(strs + docs[*(const int *)p1].name, strs + docs[*(const int *)p2].name);
+}
+
+// the old doc called name, or -1; by_name is the old docs sorted by name
+static
+int
+Search_FindDoc(int * by_name, char * name)
+{
+	int lo = 0;
+	int hi = hdr ? hdr->num_docs : 0;
+
+	while(lo < hi) {
+		int mid = (lo + hi) / 2;
+		int cmp = strcmp(strs + docs[by_name[mid]].name, name);
+
+		if(cmp == 0) {
+			return by_name[mid];
+		} else if(cmp < 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return -1;
+}
+
+
+/**************************************************************************
+ * Rebuild
+ *
+ * Writes an index of the documents in names to the .tmp file, for
+ * Search_Swap to put in place. An old entry is reused if
+ * its mtime and size still match (or without looking, if trust is set),
+ * except for the document called force, which is always read again.
+ * Runs as the sync job, progress, which the reading is reported to.
+ **************************************************************************/
+
+static
+int
+Search_Rebuild(char ** names, int num_names, int trust, char * force, cs_job_t * progress)
+{
+	builder_t b;
+	int num_old = hdr ? hdr->num_docs : 0;
+	int * by_name = (int *)malloc((num_old + 1) * sizeof(int));
+	int * renum = (int *)malloc((num_old + 1) * sizeof(int));
+	char * fresh = (char *)calloc(num_names + 1, 1);
+	int ok;
+	int i;
+
+	memset(&b, 0, sizeof(b));
+
+	for(i = 0; i < num_old; ++i) {
+		by_name[i] = i;
+		renum[i] = -1;
+	}
+
+	qsort(by_name, num_old, sizeof(int), Search_DocCmp);
+
+	// which old entries are still good (-2 marks "keep" for now)
+	for(i = 0; i < num_names; ++i) {
+		int old = Search_FindDoc(by_name, names[i]);
+		int keep = (old >= 0 && !(force && !strcmp(names[i], force)));
+
+		if(keep && !trust) {
+			unsigned long long mtime = 0;
+			unsigned long long size = 0;
+
+			keep = Files_Stat(names[i], &mtime, &size) &&
+				mtime == (docs[old].mtime_lo | ((unsigned long long)docs[old].mtime_hi << 32)) &&
+				size == (docs[old].size_lo | ((unsigned long long)docs[old].size_hi << 32));
+		}
+
+		if(keep) {
+			renum[old] = -2;
+		} else {
+			fresh[i] = 1;
+		}
+	}
+
+	// kept documents first, in their old order
+	for(i = 0; i < num_old; ++i) {
+		if(renum[i] == -2) {
+			build_doc_t * d = Build_Doc(&b, strs + docs[i].name);
+
+			d->tokens = docs[i].tokens;
+			d->mtime = docs[i].mtime_lo | ((unsigned long long)docs[i].mtime_hi << 32);
+			d->size = docs[i].size_lo | ((unsigned long long)docs[i].size_hi << 32);
+			b.total_tokens += d->tokens;
+
+			renum[i] = b.num_docs - 1;
+		}
+	}
+
+	// carry their postings over
+	for(i = 0; num_old > 0 && i < (int)hdr->num_terms; ++i) {
+		const unsigned char * p = posts + terms[i].post;
+		const unsigned char * end = p + terms[i].post_len;
+		build_term_t * t = 0;
+		unsigned int doc = 0;
+
+		while(p < end) {
+			unsigned int delta;
+			unsigned int count;
+
+			p = Search_GetVarint(p, end, &delta);
+			p = Search_GetVarint(p, end, &count);
+			doc += delta;
+
+			if(doc < (unsigned int)num_old && renum[doc] >= 0) {
+				if(!t) {
+					t = Build_Term(&b, strs + terms[i].str);
+				}
+				Build_Posting(t, renum[doc], count);
+			}
+		}
+	}
+
+	// and read the rest
+	Build_ReadAll(&b, names, fresh, num_names, progress);
+
+	ok = Build_Write(&b);
+
+	Build_Destroy(&b);
+	free(by_name);
+	free(renum);
+	free(fresh);
+
+	return ok;
+}
+
+
+/**************************************************************************
+ * Sync
+ *
+ * The build runs on a thread of its own (which fans the reading out to
+ * the pool) against the mapped old index, so nothing may remap it until
+ * Search_Progress sees the build finish and swaps the new one in.
+ **************************************************************************/
+
+static cs_job_t sync_job = {0};
+static int sync_written = 0;
+static int sync_again = 0;     // a save came in while syncing
+static char ** sync_names = 0;
+static int sync_num = 0;
+static int sync_trust = 0;     // see Search_Rebuild
+static char * sync_force = 0;  // one of sync_names
+
+static
+void
+Search_SyncMain(cs_job_t * job)
+{
+	sync_written = Search_Rebuild(sync_names, sync_num, sync_trust, sync_force, job);
+}
+
+// once the thread's done (or stopped)
+static
+void
+Search_FinishSync()
+{
+	Search_Swap(sync_written);
+
+	Files_FreeNames(sync_names, sync_num);
+	sync_names = 0;
+	sync_num = 0;
+}
+
+int
+Search_StartSync()
+{
+	if(Job_Running(&sync_job)) {
+		return 1;
+	}
+
+	if(!hdr) {
+		Search_Map();
+	}
+
+	// the folder's list can change under the build, so it gets a copy
+	sync_names = Files_CopyNames(&sync_num);
+	sync_trust = 0;
+	sync_force = 0;
+	sync_again = 0;
+
+	if(!Job_Start(&sync_job, Search_SyncMain)) {
+		fputs("Could not start the search index thread!\n", stderr);
+
+		Files_FreeNames(sync_names, sync_num);
+		sync_names = 0;
+		sync_num = 0;
+
+		return 0;
+	}
+
+	return 1;
+}
+
+int
+Search_Progress(int * done, int * total)
+{
+	if(!Job_Running(&sync_job)) {
+		return 0;
+	}
+
+	if(Job_Progress(&sync_job, done, total)) {
+		return 1;
+	}
+
+	Search_FinishSync();
+
+	// pick up what was saved in the meantime
+	if(sync_again) {
+		return Search_StartSync();
+	}
+
+	return 0;
+}
+
+int
+Search_Update(char * name)
+{
+	int i;
+
+	// the build running now may have read it before the save
+	if(Job_Running(&sync_job)) {
+		sync_again = 1;
+		return 1;
+	}
+
+	if(!hdr && !Search_Map()) {
+		return 0;
+	}
+
+	// the documents the index has, trusted as they are, and this one
+	// read again; the map stays as it is till the build is swapped in
+	sync_names = (char **)malloc((hdr->num_docs + 2) * sizeof(char *));
+	sync_num = 0;
+	sync_force = 0;
+
+	for(i = 0; i < (int)hdr->num_docs; ++i) {
+		char * doc_name = strs + docs[i].name;
+
+		sync_names[sync_num] = (char *)malloc(strlen(doc_name) + 1);
+		strcpy(sync_names[sync_num], doc_name);
+
+		if(!strcmp(doc_name, name)) {
+			sync_force = sync_names[sync_num];
+		}
+		++sync_num;
+	}
+
+	if(!sync_force) {
+		sync_force = sync_names[sync_num++] = (char *)malloc(strlen(name) + 1);
+		strcpy(sync_force, name);
+	}
+
+	sync_trust = 1;
+	sync_again = 0;
+
+	if(!Job_Start(&sync_job, Search_SyncMain)) {
+		fputs("Could not start the search index thread!\n", stderr);
+
+		Files_FreeNames(sync_names, sync_num);
+		sync_names = 0;
+		sync_num = 0;
+		sync_force = 0;
+
+		return 0;
+	}
+
+	return 1;
+}
+
+
+/**************************************************************************
+ * Query
+ *
+ * Ranks with BM25 over the documents that have every query word (the
+ * last one as a prefix, unless the query ends in a space).
+ **************************************************************************/
+
+#define BM25_K1 1.2f
+#define BM25_B 0.75f
+
+static float * scores = 0;
+static unsigned int * matched = 0;
+static int * touched = 0;
+static int scores_size = 0;
+
+static
+int
+Search_ScoreCmp(const void * p1, const void * p2)
+{
+	float s1 = scores[*(const int *)p1];
+	float s2 = scores[*(const int *)p2];
+
+	return (s1 < s2) - (s1 > s2);
+}
+
+// index of the first term >= term
+static
+int
+Search_LowerBound(const char * term)
+{
+	int lo = 0;
+	int hi = hdr->num_terms;
+
+	while(lo < hi) {
+		int mid = (lo + hi) / 2;
+
+		if(strcmp(strs + terms[mid].str, term) < 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+files_t*
+Search_Query(char * query)
+{
+	char words[QUERY_MAX_TERMS][TERM_MAX + 1];
+	const unsigned char * q = (const unsigned char *)query;
+	const unsigned char * q_end = q + strlen(query);
+	int num_words = 0;
+	int num_touched = 0;
+	int prefix;
+	unsigned int all;
+	float avg_len;
+	int w;
+	int i;
+
+	if(!*query) {
+		return Files_Get();
+	}
+
+	hits.len = 0;
+
+	// while syncing, the old index (if any) is all there is
+	if(!hdr && (Job_Running(&sync_job) || !Search_Map())) {
+		return &hits;
+	}
+
+	while(num_words < QUERY_MAX_TERMS && Search_NextToken(&q, q_end, words[num_words])) {
+		++num_words;
+	}
+
+	if(num_words == 0 || hdr->num_docs == 0) {
+		return &hits;
+	}
+
+	prefix = (q_end > (const unsigned char *)query) && IS_WORD(q_end[-1]);
+	all = (1u << num_words) - 1;
+	avg_len = (float)hdr->total_tokens / hdr->num_docs;
+
+	if(scores_size < (int)hdr->num_docs) {
+		free(scores);
+		free(matched);
+		free(touched);
+		scores_size = hdr->num_docs;
+		scores = (float *)calloc(scores_size, sizeof(float));
+		matched = (unsigned int *)calloc(scores_size, sizeof(unsigned int));
+		touched = (int *)malloc(scores_size * sizeof(int));
+	}
+
+	for(w = 0; w < num_words; ++w) {
+		int first = Search_LowerBound(words[w]);
+		int last = first;
+		size_t len = strlen(words[w]);
+		int t;
+
+		if(prefix && w == num_words - 1) {
+			while(last < (int)hdr->num_terms && last - first < PREFIX_MAX_TERMS &&
+				!strncmp(strs + terms[last].str, words[w], len)) {
+				++last;
+			}
+		} else if(first < (int)hdr->num_terms && !strcmp(strs + terms[first].str, words[w])) {
+			last = first + 1;
+		}
+
+		for(t = first; t < last; ++t) {
+			const unsigned char * p = posts + terms[t].post;
+			const unsigned char * end = p + terms[t].post_len;
+			float df = terms[t].df;
+			float idf = log(1.0f + (hdr->num_docs - df + 0.5f) / (df + 0.5f));
+			unsigned int doc = 0;
+
+			while(p < end) {
+				unsigned int delta;
+				unsigned int count;
+				float norm;
+
+				p = Search_GetVarint(p, end, &delta);
+				p = Search_GetVarint(p, end, &count);
+				doc += delta;
+
+				if(doc >= hdr->num_docs) {
+					break;
+				}
+
+				// only documents that had all the words so far matter
+				if(matched[doc] != ((1u << w) - 1) && !(matched[doc] & (1u << w))) {
+					continue;
+				}
+
+				if(!matched[doc]) {
+					touched[num_touched++] = doc;
+				}
+
+				norm = BM25_K1 * (1.0f - BM25_B + BM25_B * docs[doc].tokens / avg_len);
+				scores[doc] += idf * (count * (BM25_K1 + 1.0f)) / (count + norm);
+				matched[doc] |= 1u << w;
+			}
+		}
+	}
+
+	// keep the documents that had every word, best first
+	for(i = 0, w = 0; i < num_touched; ++i) {
+		if(matched[touched[i]] == all) {
+			touched[w++] = touched[i];
+		} else {
+			scores[touched[i]] = 0.0f;
+			matched[touched[i]] = 0;
+		}
+	}
+
+	num_touched = w;
+	qsort(touched, num_touched, sizeof(int), Search_ScoreCmp);
+
+	if(hits.cap < SEARCH_MAX_HITS) {
+		hits.cap = SEARCH_MAX_HITS;
+		hits.names = (char **)realloc(hits.names, hits.cap * sizeof(char *));
+	}
+
+	for(i = 0; i < num_touched; ++i) {
+		if(i < SEARCH_MAX_HITS) {
+			hits.names[hits.len++] = strs + docs[touched[i]].name;
+		}
+		scores[touched[i]] = 0.0f;
+		matched[touched[i]] = 0;
+	}
+
+	return &hits;
+}
+
+
+void
+Search_Cleanup()
+{
+	if(Job_Running(&sync_job)) {
+		Job_Stop(&sync_job);
+		Search_FinishSync();
+	}
+
+	Job_Destroy(&sync_job);
+
+	Search_Unmap();
+
+	free(hits.names);
+	free(scores);
+	free(matched);
+	free(touched);
+
+	hits.names = 0;
+	hits.len = 0;
+	hits.cap = 0;
+	scores = 0;
+	matched = 0;
+	touched = 0;
+	scores_size = 0;
+}
@@ -0,0 +1,89 @@
+/*************************************************************************
+ * search.h -- Full-text search over the documents folder.
+ *
+ * Candlestick App: Just Write. A minimalist, cross-platform writing app.
+ * Copyright (C) 2013 Thomas Klemz
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************************/
+
+#ifndef CS_SEARCH_H
+#define CS_SEARCH_H
+
+#include "files.h"
+
+// the index lives next to the documents folder, not in it, so writing
+// it doesn't change the folder's mtime (and force a rescan of it)
+#define SEARCH_INDEX_FILE DOCS_FOLDER "../.search-index"
+#define SEARCH_MAX_HITS 200
+
+
+/**************************************************************************
+ * StartSync
+ *
+ * Starts bringing the index up to date with the documents folder in
+ * the background: only the documents that are new or changed (by mtime
+ * and size) since they were indexed are read again, on every core.
+ * Queries keep answering from the old index until it's done. Returns 0
+ * if the build couldn't be started.
+ **************************************************************************/
+
+int
+Search_StartSync();
+
+
+/**************************************************************************
+ * Progress
+ *
+ * While a sync runs, returns 1 with the number of documents read so far
+ * and how many there are to read. Once the build is done, the first
+ * call puts the new index in place (any earlier Search_Query result
+ * goes stale) and returns 0. Call it from the thread that queries.
+ **************************************************************************/
+
+int
+Search_Progress(int * done, int * total);
+
+
+/**************************************************************************
+ * Update
+ *
+ * Re-indexes a single document (name with extension) after it was
+ * saved, on the sync thread: only it is read again, and the others
+ * are kept as indexed without looking. Returns 1 if that's under way
+ * (Search_Progress puts it in place like a sync), 0 if there's no
+ * index yet (the first sync builds it). During a sync, another one is
+ * run once it's done instead.
+ **************************************************************************/
+
+int
+Search_Update(char * name);
+
+
+/**************************************************************************
+ * Query
+ *
+ * Returns the documents matching the words in query, best first (at
+ * most SEARCH_MAX_HITS). The last word also matches as a prefix while
+ * it's still being typed. The result belongs to this module and stays
+ * valid until the next Search_* call.
+ **************************************************************************/
+
+files_t*
+Search_Query(char * query);
+
+void
+Search_Cleanup();
+
+#endif
@@ -0,0 +1,458 @@
+/*************************************************************************
+ * thread.c -- Threads, locks and a work-stealing pool.
+ *
+ * Candlestick App: Just Write. A minimalist, cross-platform writing app.
+ * Copyright (C) 2013 Thomas Klemz
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************************/
+
+#include "thread.h"
+
+#include <stdlib.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#  include <unistd.h>
+#endif
+
+
+typedef struct {
+	void (*func)(void*);
+	void * arg;
+} thread_start_t;
+
+#if defined(_WIN32)
+static
+DWORD WINAPI
+Thread_Main(LPVOID p)
+#else
+static
+void *
+Thread_Main(void * p)
+#endif
+{
+	thread_start_t start = *(thread_start_t *)p;
+
+	free(p);
+	start.func(start.arg);
+
+	return 0;
+}
+
+int
+Thread_Start(cs_thread_t * thread, void (*func)(void*), void * arg)
+{
+	thread_start_t * start = (thread_start_t *)malloc(sizeof(thread_start_t));
+
+	start->func = func;
+	start->arg = arg;
+
+#if defined(_WIN32)
+	*thread = CreateThread(NULL, 0, Thread_Main, start, 0, NULL);
+
+	if(!*thread) {
+		free(start);
+		return 0;
+	}
+#else
+	if(pthread_create(thread, NULL, Thread_Main, start) != 0) {
+		free(start);
+		return 0;
+	}
+#endif
+
+	return 1;
+}
+
+void
+Thread_Join(cs_thread_t * thread)
+{
+#if defined(_WIN32)
+	WaitForSingleObject(*thread, INFINITE);
+	CloseHandle(*thread);
+#else
+	pthread_join(*thread, NULL);
+#endif
+}
+
+int
+Thread_NumCores()
+{
+	int n = 1;
+
+#if defined(_WIN32)
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	n = (int)info.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+	n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+	return n > 0 ? n : 1;
+}
+
+void
+Thread_Sleep(int ms)
+{
+#if defined(_WIN32)
+	Sleep(ms);
+#else
+	usleep(ms * 1000);
+#endif
+}
+
+void
+Mutex_Init(cs_mutex_t * mutex)
+{
+#if defined(_WIN32)
+	InitializeCriticalSection(mutex);
+#else
+	pthread_mutex_init(mutex, NULL);
+#endif
+}
+
+void
+Mutex_Lock(cs_mutex_t * mutex)
+{
+#if defined(_WIN32)
+	EnterCriticalSection(mutex);
+#else
+	pthread_mutex_lock(mutex);
+#endif
+}
+
+void
+Mutex_Unlock(cs_mutex_t * mutex)
+{
+#if defined(_WIN32)
+	LeaveCriticalSection(mutex);
+#else
+	pthread_mutex_unlock(mutex);
+#endif
+}
+
+void
+Mutex_Destroy(cs_mutex_t * mutex)
+{
+#if defined(_WIN32)
+	DeleteCriticalSection(mutex);
+#else
+	pthread_mutex_destroy(mutex);
+#endif
+}
+
+void
+Cond_Init(cs_cond_t * cond)
+{
+#if defined(_WIN32)
+	InitializeConditionVariable(cond);
+#else
+	pthread_cond_init(cond, NULL);
+#endif
+}
+
+void
+Cond_Wait(cs_cond_t * cond, cs_mutex_t * mutex)
+{
+#if defined(_WIN32)
+	SleepConditionVariableCS(cond, mutex, INFINITE);
+#else
+	pthread_cond_wait(cond, mutex);
+#endif
+}
+
+void
+Cond_Broadcast(cs_cond_t * cond)
+{
+#if defined(_WIN32)
+	WakeAllConditionVariable(cond);
+#else
+	pthread_cond_broadcast(cond);
+#endif
+}
+
+void
+Cond_Destroy(cs_cond_t * cond)
+{
+#if defined(_WIN32)
+	(void)cond;
+#else
+	pthread_cond_destroy(cond);
+#endif
+}
+
+
+/**************************************************************************
+ * Jobs
+ **************************************************************************/
+
+static
+void
+Job_Main(void * p)
+{
+	cs_job_t * job = (cs_job_t *)p;
+
+	job->func(job);
+
+	Mutex_Lock(&job->lock);
+	job->finished = 1;
+	Mutex_Unlock(&job->lock);
+}
+
+int
+Job_Start(cs_job_t * job, void (*func)(cs_job_t * job))
+{
+	if(job->running) {
+		return 0;
+	}
+
+	if(!job->lock_ready) {
+		Mutex_Init(&job->lock);
+		job->lock_ready = 1;
+	}
+
+	job->func = func;
+	job->done = 0;
+	job->total = 0;
+	job->finished = 0;
+	job->cancel = 0;
+
+	if(!Thread_Start(&job->thread, Job_Main, job)) {
+		return 0;
+	}
+
+	job->running = 1;
+
+	return 1;
+}
+
+int
+Job_Running(cs_job_t * job)
+{
+	return job->running;
+}
+
+int
+Job_Progress(cs_job_t * job, int * done, int * total)
+{
+	int finished;
+
+	if(!job->running) {
+		return 0;
+	}
+
+	Mutex_Lock(&job->lock);
+	*done = job->done;
+	*total = job->total;
+	finished = job->finished;
+	Mutex_Unlock(&job->lock);
+
+	if(!finished) {
+		return 1;
+	}
+
+	Thread_Join(&job->thread);
+	job->running = 0;
+
+	return 0;
+}
+
+void
+Job_Stop(cs_job_t * job)
+{
+	if(job->running) {
+		Mutex_Lock(&job->lock);
+		job->cancel = 1;
+		Mutex_Unlock(&job->lock);
+
+		Thread_Join(&job->thread);
+		job->running = 0;
+	}
+}
+
+void
+Job_Destroy(cs_job_t * job)
+{
+	Job_Stop(job);
+
+	if(job->lock_ready) {
+		Mutex_Destroy(&job->lock);
+		job->lock_ready = 0;
+	}
+}
+
+void
+Job_SetTotal(cs_job_t * job, int total)
+{
+	Mutex_Lock(&job->lock);
+	job->done = 0;
+	job->total = total;
+	Mutex_Unlock(&job->lock);
+}
+
+void
+Job_Step(cs_job_t * job)
+{
+	Mutex_Lock(&job->lock);
+	++job->done;
+	Mutex_Unlock(&job->lock);
+}
+
+int
+Job_Cancelled(cs_job_t * job)
+{
+	int cancel;
+
+	Mutex_Lock(&job->lock);
+	cancel = job->cancel;
+	Mutex_Unlock(&job->lock);
+
+	return cancel;
+}
+
+/**************************************************************************
+ * Pool
+ *
+ * Every worker owns a range [lo, hi) of items, behind its own lock. It
+ * takes from the bottom of its range; a thief takes the top half of
+ * someone else's. Items are never added once the pool runs, so one
+ * pass that finds every range empty means the work is all handed out.
+ **************************************************************************/
+
+typedef struct pool_s pool_t;
+
+typedef struct {
+	cs_mutex_t lock;
+	int lo;
+	int hi;
+	int id;
+	pool_t * pool;
+	cs_thread_t thread;
+} pool_worker_t;
+
+struct pool_s {
+	pool_worker_t workers[POOL_MAX_WORKERS];
+	int num_workers;
+	pool_task_t task;
+	void * arg;
+};
+
+// the next item for w, stealing if its own range is empty; -1 when
+// there's nothing left anywhere
+static
+int
+Pool_Next(pool_worker_t * w)
+{
+	pool_t * pool = w->pool;
+	int item = -1;
+	int i;
+
+	Mutex_Lock(&w->lock);
+	if(w->lo < w->hi) {
+		item = w->lo++;
+	}
+	Mutex_Unlock(&w->lock);
+
+	for(i = 1; item < 0 && i < pool->num_workers; ++i) {
+		pool_worker_t * victim = &pool->workers[(w->id + i) % pool->num_workers];
+		int lo = 0;
+		int hi = 0;
+
+		Mutex_Lock(&victim->lock);
+		if(victim->lo < victim->hi) {
+			lo = victim->lo + (victim->hi - victim->lo) / 2;
+			hi = victim->hi;
+			victim->hi = lo;
+		}
+		Mutex_Unlock(&victim->lock);
+
+		if(lo < hi) {
+			// the first of the stolen items is run now, the rest become ours
+			item = lo;
+
+			Mutex_Lock(&w->lock);
+			w->lo = lo + 1;
+			w->hi = hi;
+			Mutex_Unlock(&w->lock);
+		}
+	}
+
+	return item;
+}
+
+static
+void
+Pool_Work(void * p)
+{
+	pool_worker_t * w = (pool_worker_t *)p;
+	int item;
+
+	while((item = Pool_Next(w)) >= 0) {
+		w->pool->task(item, w->id, w->pool->arg);
+	}
+}
+
+int
+Pool_Workers(int num_items)
+{
+	int n = Thread_NumCores();
+
+	if(n > POOL_MAX_WORKERS) {
+		n = POOL_MAX_WORKERS;
+	}
+	if(n > num_items) {
+		n = num_items;
+	}
+
+	return n > 0 ? n : 1;
+}
+
+void
+Pool_Run(int num_items, pool_task_t task, void * arg)
+{
+	pool_t pool;
+	int started[POOL_MAX_WORKERS];
+	int i;
+
+	pool.num_workers = Pool_Workers(num_items);
+	pool.task = task;
+	pool.arg = arg;
+
+	for(i = 0; i < pool.num_workers; ++i) {
+		pool_worker_t * w = &pool.workers[i];
+
+		Mutex_Init(&w->lock);
+		w->lo = (int)((long long)num_items * i / pool.num_workers);
+		w->hi = (int)((long long)num_items * (i + 1) / pool.num_workers);
+		w->id = i;
+		w->pool = &pool;
+	}
+
+	// if a thread can't be made, its share gets stolen by the others
+	for(i = 1; i < pool.num_workers; ++i) {
+		started[i] = Thread_Start(&pool.workers[i].thread, Pool_Work, &pool.workers[i]);
+	}
+
+	Pool_Work(&pool.workers[0]);
+
+	for(i = 1; i < pool.num_workers; ++i) {
+		if(started[i]) {
+			Thread_Join(&pool.workers[i].thread);
+		}
+	}
+
+	for(i = 0; i < pool.num_workers; ++i) {
+		Mutex_Destroy(&pool.workers[i].lock);
+	}
+}
@@ -0,0 +1,160 @@
+/*************************************************************************
+ * thread.h -- Threads, locks and a work-stealing pool.
+ *
+ * Candlestick App: Just Write. A minimalist, cross-platform writing app.
+ * Copyright (C) 2013 Thomas Klemz
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************************/
+
+#ifndef CS_THREAD_H
+#define CS_THREAD_H
+
+#if defined(_WIN32)
+#  include <windows.h>
+typedef HANDLE cs_thread_t;
+typedef CRITICAL_SECTION cs_mutex_t;
+typedef CONDITION_VARIABLE cs_cond_t;
+#else
+#  include <pthread.h>
+typedef pthread_t cs_thread_t;
+typedef pthread_mutex_t cs_mutex_t;
+typedef pthread_cond_t cs_cond_t;
+#endif
+
+// the most threads a pool runs at once
+#define POOL_MAX_WORKERS 16
+
+
+/**************************************************************************
+ * Threads
+ *
+ * Thin wrappers so the modules that go wide don't need their own
+ * #ifdefs. Thread_Start returns 0 if no thread could be made.
+ **************************************************************************/
+
+int
+Thread_Start(cs_thread_t * thread, void (*func)(void*), void * arg);
+
+void
+Thread_Join(cs_thread_t * thread);
+
+// the number of processors, at least 1
+int
+Thread_NumCores();
+
+void
+Thread_Sleep(int ms);
+
+void
+Mutex_Init(cs_mutex_t * mutex);
+
+void
+Mutex_Lock(cs_mutex_t * mutex);
+
+void
+Mutex_Unlock(cs_mutex_t * mutex);
+
+void
+Mutex_Destroy(cs_mutex_t * mutex);
+
+// Cond_Wait lets go of mutex (held) until woken, then takes it back;
+// it can wake early, so check what's being waited for in a loop
+void
+Cond_Init(cs_cond_t * cond);
+
+void
+Cond_Wait(cs_cond_t * cond, cs_mutex_t * mutex);
+
+void
+Cond_Broadcast(cs_cond_t * cond);
+
+void
+Cond_Destroy(cs_cond_t * cond);
+
+
+/**************************************************************************
+ * Jobs
+ *
+ * One long piece of work on a thread of its own (which may fan out to
+ * the pool), polled by the app. Job_Start runs func(job) on a new
+ * thread, or returns 0 if it couldn't; from there, the work reports
+ * with Job_SetTotal and Job_Step and stops early once Job_Cancelled.
+ * Job_Progress returns 1 with how far it's got while it runs; once it
+ * has finished, it joins the thread and returns 0. Job_Stop cancels a
+ * running job and waits for it. A zeroed cs_job_t is ready to start.
+ **************************************************************************/
+
+typedef struct cs_job_s {
+	cs_thread_t thread;
+	cs_mutex_t lock;
+	int lock_ready;
+	int running;               // there's a thread to join
+	void (*func)(struct cs_job_s * job);
+	int done;                  // these under the lock
+	int total;
+	int finished;
+	int cancel;
+} cs_job_t;
+
+int
+Job_Start(cs_job_t * job, void (*func)(cs_job_t * job));
+
+int
+Job_Running(cs_job_t * job);
+
+int
+Job_Progress(cs_job_t * job, int * done, int * total);
+
+void
+Job_Stop(cs_job_t * job);
+
+// stops it if it's running and lets go of its lock
+void
+Job_Destroy(cs_job_t * job);
+
+// these from the job's thread (or its pool)
+
+// starts the count over, of total
+void
+Job_SetTotal(cs_job_t * job, int total);
+
+void
+Job_Step(cs_job_t * job);
+
+int
+Job_Cancelled(cs_job_t * job);
+
+
+/**************************************************************************
+ * Pool_Run
+ *
+ * Calls task(item, worker, arg) once for every item in [0, num_items),
+ * spread over one worker per core (the calling thread is worker 0), and
+ * returns when they're all done. Each worker starts on its own even
+ * share of the items and, once that runs out, steals half of what's
+ * left of another's, so a few big files don't hold up the rest.
+ * Pool_Workers tells how many workers that will be, for sizing any
+ * per-worker scratch space; worker is always below it.
+ **************************************************************************/
+
+typedef void (*pool_task_t)(int item, int worker, void * arg);
+
+int
+Pool_Workers(int num_items);
+
+void
+Pool_Run(int num_items, pool_task_t task, void * arg);
+
+#endif
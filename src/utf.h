@@ -61,6 +61,8 @@ Rune		toupperrune(Rune c);
 char*		utfecpy(char *to, char *e, char *from);
 int		utflen(char *s);
 int		utfnlen(const char *s, long m);
+int		utfvalid(char *s, long len);
+long		utfcount(char *s, long len);
 char*		utfrrune(char *s, long c);
 char*		utfrune(char *s, long c);
 char*		utfutf(char *s1, char *s2);
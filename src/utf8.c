@@ -101,22 +101,256 @@ char * utf8_from_ucs(char *buffer, int *str, int n)
 int
 utflen(char *s)
 {
-	int c;
-	long n;
-	Rune rune;
+	return (int)utfcount(s, (long)strlen(s));
+}
+
+/*
+ * The Unicode white space (Zs, plus the ASCII controls and line and
+ * paragraph separators); utf.h has declared it all along.
+ */
+int
+isspacerune(Rune c)
+{
+	if(c < Runeself)
+		return c == ' ' || (c >= '\t' && c <= '\r');
+	return c == 0x85 || c == 0xA0 || c == 0x1680 ||
+		(c >= 0x2000 && c <= 0x200A) || c == 0x2028 || c == 0x2029 ||
+		c == 0x202F || c == 0x205F || c == 0x3000 || c == 0xFEFF;
+}
+
+/*
+ * Bulk kernels: utfvalid and utfcount look at whole blocks of bytes at
+ * a time, with SSE2 (always there on x86-64) or AVX2 (if the processor
+ * has it, checked once at run time), and 8 bytes to a word elsewhere.
+ *
+ * Validation skips runs of ASCII a block at a time and only decodes
+ * the multibyte runes one by one, so prose in Latin script goes at
+ * memory speed. Counting counts the bytes that don't continue a rune
+ * (not 10xxxxxx), which for valid UTF-8 is the number of runes.
+ */
+
+#if defined(__x86_64__) || defined(_M_X64) || \
+	(defined(__i386__) && defined(__SSE2__)) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define UTF_SSE2 1
+#  include <emmintrin.h>
+#  if defined(__GNUC__) || defined(_MSC_VER)
+#    define UTF_AVX2 1
+#    include <immintrin.h>
+#  endif
+#endif
+
+#if defined(_MSC_VER)
+#  include <intrin.h>
+static int
+utfctz(unsigned int m)
+{
+	unsigned long i;
+	_BitScanForward(&i, m);
+	return (int)i;
+}
+#else
+#  define utfctz(m) __builtin_ctz(m)
+#endif
+
+#if defined(UTF_AVX2) && defined(__GNUC__)
+#  define UTF_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#  define UTF_TARGET_AVX2
+#endif
+
+/* how many bytes from s on are ASCII */
+static long
+asciirun(uchar *s, long len)
+{
+	long i = 0;
+
+	while(len - i >= 8) {
+		unsigned long long w;
+		memcpy(&w, s+i, 8);
+		if(w & 0x8080808080808080ULL)
+			break;
+		i += 8;
+	}
+	while(i < len && s[i] < Runeself)
+		i++;
+	return i;
+}
+
+static long
+runecount(uchar *s, long len)
+{
+	long i, n;
 
 	n = 0;
-	for(;;) {
-		c = *(uchar*)s;
-		if(c < Runeself) {
-			if(c == 0)
-				return n;
-			s++;
-		} else
-			s += chartorune(&rune, s);
-		n++;
+	for(i = 0; i < len; i++)
+		n += (s[i] & 0xC0) != 0x80;
+	return n;
+}
+
+#ifdef UTF_SSE2
+static long
+asciirun_sse2(uchar *s, long len)
+{
+	long i = 0;
+
+	while(len - i >= 16) {
+		int m = _mm_movemask_epi8(_mm_loadu_si128((__m128i*)(s+i)));
+		if(m)
+			return i + utfctz(m);
+		i += 16;
 	}
-	return 0;
+	return i + asciirun(s+i, len-i);
+}
+
+static long
+runecount_sse2(uchar *s, long len)
+{
+	/* as signed bytes, 10xxxxxx is -128..-65 and nothing else is */
+	__m128i lead = _mm_set1_epi8(-65);
+	__m128i zero = _mm_setzero_si128();
+	long i = 0;
+	long n = 0;
+
+	while(len - i >= 16) {
+		/* byte counters, emptied before any can pass 255 */
+		__m128i acc = zero;
+		int k;
+
+		for(k = 0; k < 255 && len - i >= 16; k++, i += 16) {
+			__m128i v = _mm_loadu_si128((__m128i*)(s+i));
+			acc = _mm_sub_epi8(acc, _mm_cmpgt_epi8(v, lead));
+		}
+		acc = _mm_sad_epu8(acc, zero);
+		n += _mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+	}
+	return n + runecount(s+i, len-i);
+}
+#endif
+
+#ifdef UTF_AVX2
+UTF_TARGET_AVX2
+static long
+asciirun_avx2(uchar *s, long len)
+{
+	long i = 0;
+
+	while(len - i >= 32) {
+		unsigned int m = (unsigned int)_mm256_movemask_epi8(_mm256_loadu_si256((__m256i*)(s+i)));
+		if(m)
+			return i + utfctz(m);
+		i += 32;
+	}
+	return i + asciirun_sse2(s+i, len-i);
+}
+
+UTF_TARGET_AVX2
+static long
+runecount_avx2(uchar *s, long len)
+{
+	__m256i lead = _mm256_set1_epi8(-65);
+	__m256i zero = _mm256_setzero_si256();
+	long i = 0;
+	long n = 0;
+
+	while(len - i >= 32) {
+		__m256i acc = zero;
+		__m128i sum;
+		int k;
+
+		for(k = 0; k < 255 && len - i >= 32; k++, i += 32) {
+			__m256i v = _mm256_loadu_si256((__m256i*)(s+i));
+			acc = _mm256_sub_epi8(acc, _mm256_cmpgt_epi8(v, lead));
+		}
+		acc = _mm256_sad_epu8(acc, zero);
+		sum = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+		n += _mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+	}
+	return n + runecount_sse2(s+i, len-i);
+}
+
+static int
+hasavx2(void)
+{
+#  if defined(_MSC_VER)
+	int r[4];
+
+	__cpuid(r, 0);
+	if(r[0] < 7)
+		return 0;
+	/* the OS has to save the ymm registers too (OSXSAVE, AVX, XCR0) */
+	__cpuid(r, 1);
+	if((r[2] & (1<<27 | 1<<28)) != (1<<27 | 1<<28) || (_xgetbv(0) & 6) != 6)
+		return 0;
+	__cpuidex(r, 7, 0);
+	return (r[1] & (1<<5)) != 0;
+#  else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#  endif
+}
+#endif
+
+static long (*asciirunfn)(uchar*, long) = 0;
+static long (*runecountfn)(uchar*, long) = 0;
+
+/* picks the kernels; racing threads all pick the same ones */
+static void
+utfinit(void)
+{
+	long (*ascii)(uchar*, long) = asciirun;
+	long (*count)(uchar*, long) = runecount;
+
+#ifdef UTF_SSE2
+	ascii = asciirun_sse2;
+	count = runecount_sse2;
+#endif
+#ifdef UTF_AVX2
+	if(hasavx2()) {
+		ascii = asciirun_avx2;
+		count = runecount_avx2;
+	}
+#endif
+	runecountfn = count;
+	asciirunfn = ascii;
+}
+
+/*
+ * 1 if the len bytes at s are all whole, well formed UTF-8 (as far as
+ * chartorune goes), 0 otherwise. s needn't be NUL terminated.
+ */
+int
+utfvalid(char *s, long len)
+{
+	long i;
+	int n;
+	Rune rune;
+
+	if(!asciirunfn)
+		utfinit();
+
+	for(i = 0; i < len; i += n) {
+		i += asciirunfn((uchar*)s+i, len-i);
+		if(i >= len)
+			break;
+		if(!fullrune(s+i, (int)(len-i > UTFmax ? UTFmax : len-i)))
+			return 0;
+		n = chartorune(&rune, s+i);
+		if(rune == Runeerror && n == 1)
+			return 0;
+	}
+	return 1;
+}
+
+/*
+ * The number of runes in the len bytes at s (which should be valid).
+ */
+long
+utfcount(char *s, long len)
+{
+	if(!runecountfn)
+		utfinit();
+
+	return runecountfn((uchar*)s, len);
 }
 
 
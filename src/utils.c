@@ -43,41 +43,26 @@ NextP2(int a)
 
 
 /**********************************************************************
- * PushScreenCoordMat
+ * BeginScreenPass
  * 
- * makes object world coords identical to window coords
- * the new projection matrix is left on the stack
+ * sets up the state shared by everything drawn in a frame, once:
+ * object coords are window coords ((0,0) top left, w x h), no depth
+ * test or lighting, "over" blending, and texturing off (text turns it
+ * on only while it draws). Nothing is queried back from GL.
  **********************************************************************/
  
 void 
-PushScreenCoordMat() 
+BeginScreenPass(int w, int h) 
 {
-	GLint viewport[4];
-
-	glPushAttrib(GL_TRANSFORM_BIT);
-	glGetIntegerv(GL_VIEWPORT, viewport);
 	glMatrixMode(GL_PROJECTION);
-	glPushMatrix();
-		glLoadIdentity();
-		//gluOrtho2D(viewport[0],viewport[2],viewport[1],viewport[3]);
-		gluOrtho2D(viewport[1], viewport[2], viewport[3], viewport[0]);
-	//the matrix is now on the stack and setup; leave it
-	glPopAttrib();
-}
-
+	glLoadIdentity();
+	gluOrtho2D(0, w, h, 0);
+	glMatrixMode(GL_MODELVIEW);
+	glLoadIdentity();
 
-/**********************************************************************
- * PopScreenCoordMat
- * 
- * pops the projection matrix without changing the current matrix mode
- **********************************************************************/
- 
-void 
-PopScreenCoordMat() 
-{
-	glPushAttrib(GL_TRANSFORM_BIT);
-	glMatrixMode(GL_PROJECTION);
-	glPopMatrix();
-	glPopAttrib();
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_LIGHTING);
+	glDisable(GL_TEXTURE_2D);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
-
@@ -33,23 +33,13 @@ NextP2(int a);
 
 
 /**********************************************************************
- * PushScreenCoordMat
+ * BeginScreenPass
  * 
- * makes object world coords identical to window coords
- * the new projection matrix is left on the stack
+ * sets up window coords ((0,0) top left) and the 2D drawing state
+ * for the whole frame; textures are off unless text is being drawn
  **********************************************************************/
  
 void 
-PushScreenCoordMat();
-
-
-/**********************************************************************
- * PopScreenCoordMat
- * 
- * pops the projection matrix without changing the current matrix mode
- **********************************************************************/
- 
-void 
-PopScreenCoordMat();
+BeginScreenPass(int w, int h);
 
 #endif